@@ -21,8 +21,13 @@
 /********************************* Includes *******************************/
 
 #include "clUtils.h"
+#include "fitnessCache.h"
 #include <mpi.h>
 
+/******************************** Constants *******************************/
+
+const char *const AG_ERROR_TAG_UB = "Error: Too many subpopulations and global migrations for the maximum MPI tag value";
+
 /********************************* Methods ********************************/
 
 
@@ -31,17 +36,18 @@
  * @param conf The structure with all configuration parameters
  * @return The first subpopulations
  */
-Individual* createSubpopulations(const Config *const conf);
+Population* createSubpopulations(const Config *const conf);
 
 
 /**
  * @brief Island-based genetic algorithm model
- * @param subpops The initial subpopulations
+ * @param population The initial subpopulations (only in the master)
  * @param devicesObject Structure containing the OpenCL variables of a device
  * @param trDataBase The training database which will contain the instances and the features
  * @param selInstances The instances choosen as initial centroids
+ * @param fitnessCache The cache with the raw fitness of the already evaluated chromosomes (NULL if disabled)
  * @param conf The structure with all configuration parameters
  */
-void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *const trDataBase, const int *const selInstances, const Config *const conf);
+void agIslands(Population *const population, CLDevice *const devicesObject, const float *const trDataBase, const int *const selInstances, FitnessCache *const fitnessCache, const Config *const conf);
 
 #endif
@@ -0,0 +1,126 @@
+/**
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE', which is part of Hpmoon repository.
+ *
+ * This work has been funded by:
+ *
+ * Spanish 'Ministerio de Economía y Competitividad' under grants number TIN2012-32039 and TIN2015-67020-P.\n
+ * Spanish 'Ministerio de Ciencia, Innovación y Universidades' under grant number PGC2018-098813-B-C31.\n
+ * European Regional Development Fund (ERDF).
+ *
+ * @file arena.h
+ * @author agent
+ * @date 17/10/2026
+ * @brief Scratch memory for the temporaries of the generations
+ * @copyright Hpmoon (c) 2015 EFFICOMP
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/********************************* Includes *******************************/
+
+#include "config.h" // 'Config' datatype
+#include <stddef.h> // size_t
+
+/******************************** Constants *******************************/
+
+const char *const ARENA_ERROR_ALLOC = "Error: Could not allocate the scratch arena";
+const char *const ARENA_ERROR_FULL = "Error: The scratch arena is too small for the temporaries of the generation";
+
+/******************************** Structures ******************************/
+
+/**
+ * @brief Structure containing a block of scratch memory, allocated once and handed out as a stack
+ *
+ * The functions take a mark on entry and release it on return, so the temporaries of a generation (tournament pool,
+ * sorting data, K-means buffers...) never reach the heap. An arena must only be used by one thread at a time
+ */
+typedef struct ScratchArena
+{
+
+	/**
+	 * @brief The block of memory, aligned to a cache line
+	 */
+	char *memory;
+
+	/**
+	 * @brief Size in bytes of the block
+	 */
+	size_t capacity;
+
+	/**
+	 * @brief Bytes handed out so far
+	 */
+	size_t used;
+
+	/********************************* Methods ********************************/
+
+	/**
+	 * @brief The constructor with parameters. The arena is sized for the largest generation of the configuration
+	 * @param nIndividuals The maximum number of individuals which will be sorted at once
+	 * @param nThreads The maximum number of threads which will run K-means at once (0 if the CPU does not evaluate)
+	 * @param conf The structure with all configuration parameters
+	 * @return An empty arena
+	 */
+	ScratchArena(const int nIndividuals, const int nThreads, const Config *const conf);
+
+	/**
+	 * @brief The destructor
+	 */
+	~ScratchArena();
+
+	/**
+	 * @brief The arena owns its block, so it can not be copied
+	 */
+	ScratchArena(const ScratchArena &) = delete;
+	ScratchArena &operator=(const ScratchArena &) = delete;
+
+	/**
+	 * @brief Hands out a block of the arena, aligned to a cache line
+	 * @param nBytes The size in bytes of the block
+	 * @return The address of the block
+	 */
+	void *allocate(const size_t nBytes);
+
+	/**
+	 * @brief Hands out an array of the arena, aligned to a cache line
+	 * @tparam T The type of the elements
+	 * @param n The number of elements
+	 * @return The address of the array
+	 */
+	template <typename T>
+	T *allocate(const size_t n)
+	{
+		return (T *)this->allocate(n * sizeof(T));
+	}
+
+	/**
+	 * @brief Gets the current top of the arena
+	 * @return The mark which releases everything handed out after this call
+	 */
+	size_t mark() const
+	{
+		return this->used;
+	}
+
+	/**
+	 * @brief Releases all the blocks handed out after a mark
+	 * @param mark The mark returned by 'mark'
+	 */
+	void release(const size_t mark)
+	{
+		this->used = mark;
+	}
+
+} ScratchArena;
+
+/********************************* Methods ********************************/
+
+/**
+ * @brief Gets the number of heap allocations (operator new) of the process so far. The counter is only kept if 'ALLOCATION_COUNTER_ENABLED' is set
+ * @return The number of allocations of all threads, or 0 if the counter is disabled
+ */
+long int getHeapAllocations();
+
+#endif
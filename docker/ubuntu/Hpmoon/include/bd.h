@@ -21,6 +21,7 @@
 /********************************* Includes *******************************/
 
 #include "config.h" // 'Config' datatype
+#include <stdint.h> // uint32_t
 
 /******************************** Constants *******************************/
 
@@ -29,11 +30,81 @@ const char *const BD_ERROR_FILE_EMPTY = "Error: The database file is empty";
 const char *const BD_ERROR_ROW_UNEQUAL = "Error: Different number of columns in the row";
 const char *const BD_ERROR_DIMENSIONS_MIN = "Error: The database dimensions must be 4x4 or higher";
 const char *const BD_ERROR_INSTANCES_RANGE = "Error: The number of instances must be between 4 and";
-const char *const BD_ERROR_COLUMNS_UNEQUAL = "Error: The number of columns in the database must match the specified \'N_FEATURES\' parameter when compiling the program";
+const char *const BD_ERROR_COLUMNS_UNEQUAL = "Error: The number of columns in the database has changed since the master read it. Expected columns:";
+const char *const BD_ERROR_VALUE_PARSE = "Error: Invalid value in the row";
+const char *const BD_ERROR_BINARY_INVALID = "Error: The binary database is corrupted or has an unsupported version";
+const char *const BD_ERROR_BINARY_NORMALIZED = "Error: The binary database is already normalized, so it requires normalization and all its instances";
+const char *const BD_ERROR_FILE_WRITE = "Error: Could not write the binary database file";
+const char *const BD_WARNING_CACHE_WRITE = "Warning: Could not write the binary cache of the database";
+
+/********************************* Defines ********************************/
+
+/**
+ * @brief Binary database format: signature, current version, data types and extension of the automatic cache
+ */
+#define BD_BINARY_MAGIC "HPMOONDB"
+#define BD_BINARY_VERSION 1
+#define BD_DTYPE_FLOAT32 0
+#define BD_CACHE_EXTENSION ".bin"
+
+/******************************** Structures ******************************/
+
+/**
+ * @brief Header of a binary database. It is followed by the instances as a row-major block of floats
+ *
+ * The header takes 64 bytes, so the block of floats is aligned when the file is memory-mapped
+ */
+typedef struct BinaryDataBaseHeader
+{
+
+	/**
+	 * @brief Signature of the format (BD_BINARY_MAGIC, not null-terminated)
+	 */
+	char magic[8];
+
+	/**
+	 * @brief Version of the format
+	 */
+	uint32_t version;
+
+	/**
+	 * @brief Data type of the values (BD_DTYPE_FLOAT32)
+	 */
+	uint32_t dtype;
+
+	/**
+	 * @brief 1 if the values are already normalized, 0 otherwise
+	 */
+	uint32_t normalized;
+
+	/**
+	 * @brief Number of rows (instances)
+	 */
+	uint32_t nRows;
+
+	/**
+	 * @brief Number of columns (features)
+	 */
+	uint32_t nCols;
+
+	/**
+	 * @brief Reserved for future versions. Filled with zeros
+	 */
+	char reserved[36];
+
+} BinaryDataBaseHeader;
 
 
 /********************************* Methods ********************************/
 
+/**
+ * @brief Gets the number of columns (features) of the training database without reading the whole database
+ * @param conf The structure with all configuration parameters
+ * @return The number of columns
+ */
+int getDataBaseColumns(const Config *const conf);
+
+
 /**
  * @brief Reads and normalizes a database if it is required
  * @param conf The structure with all configuration parameters
@@ -42,6 +113,50 @@ const char *const BD_ERROR_COLUMNS_UNEQUAL = "Error: The number of columns in th
 float* getDataBase(const Config *const conf);
 
 
+/**
+ * @brief Gets the training database in all the processes which need it. It must be called by all processes
+ * @param conf The structure with all configuration parameters
+ * @return The database, or NULL in the master process if it does not evaluate
+ */
+float* distributeDataBase(const Config *const conf);
+
+
+/**
+ * @brief Releases a database returned by 'getDataBase' or 'distributeDataBase'. It must be called by all processes if the database is shared
+ * @param dataBase The database to be released
+ */
+void freeDataBase(const float *const dataBase);
+
+
+/**
+ * @brief Reads a text database in parallel with a locale-free parser. Each thread parses a chunk of whole lines
+ * @param fileName The name of the file containing the database
+ * @param nRows Where the number of rows is stored
+ * @param nCols Where the number of columns is stored
+ * @return The database with all its instances
+ */
+float* readTextDataBase(const char *const fileName, int *const nRows, int *const nCols);
+
+
+/**
+ * @brief Writes a database in binary format. The file is written under a temporary name and then renamed
+ * @param fileName The name of the binary file
+ * @param dataBase The database
+ * @param nRows The number of rows
+ * @param nCols The number of columns
+ * @param normalized If the values are already normalized
+ * @return true if the file has been written
+ */
+bool writeBinaryDataBase(const char *const fileName, const float *const dataBase, const int nRows, const int nCols, const bool normalized);
+
+
+/**
+ * @brief Converts the training database to binary format. The database is normalized only if it is required
+ * @param conf The structure with all configuration parameters
+ */
+void convertDataBase(const Config *const conf);
+
+
 /**
  * @brief The database is transposed
  * @param dataBase Database to be transposed
@@ -39,6 +39,7 @@ const char *const CL_ERROR_DEVICE_NAME = "Error: Could not get the device name";
 const char *const CL_ERROR_DEVICE_MAXCU = "Error: Could not get maximum number of compute units";
 const char *const CL_ERROR_DEVICE_MAXWORKITEMS = "Error: Could not get maximum number of work-items in each dimension";
 const char *const CL_ERROR_DEVICE_TYPE = "Error: Could not get the device type";
+const char *const CL_ERROR_DRIVER_VERSION = "Error: Could not get the driver version of the device";
 const char *const CL_ERROR_DEVICE_MAXMEM = "Error: Could not get the maximum local memory of the device";
 const char *const CL_ERROR_DEVICE_LOCALMEM = "Error: Local memory exceeded";
 const char *const CL_ERROR_DEVICE_CONTEXT = "Error: Could not get the context";
@@ -47,18 +48,44 @@ const char *const CL_ERROR_FILE_OPEN = "Error: An error ocurred opening the kern
 const char *const CL_ERROR_PROGRAM_BUILD = "Error: Could not create the program";
 const char *const CL_ERROR_PROGRAM_ERRORS = "Error: Could not get the compilation errors";
 const char *const CL_ERROR_KERNEL_BUILD = "Error: Could not create the kernel";
-const char *const CL_ERROR_OBJECT_SUBPOPS = "Error: Could not create the OpenCL object containing the subpopulations";
+const char *const CL_ERROR_OBJECT_SUBPOPS = "Error: Could not create the OpenCL object containing the chromosomes of the subpopulations";
 const char *const CL_ERROR_OBJECT_TRDB = "Error: Could not create the OpenCL object containing the training database";
 const char *const CL_ERROR_OBJECT_CENTROIDS = "Error: Could not create the OpenCL object containing the indexes of the initial centroids";
 const char *const CL_ERROR_KERNEL_ARGUMENT1 = "Error: Could not set the first kernel argument";
 const char *const CL_ERROR_KERNEL_ARGUMENT2 = "Error: Could not set the second kernel argument";
 const char *const CL_ERROR_KERNEL_ARGUMENT3 = "Error: Could not set the third kernel argument";
+const char *const CL_ERROR_KERNEL_ARGUMENT4 = "Error: Could not set the fourth kernel argument";
+const char *const CL_ERROR_KERNEL_ARGUMENT5 = "Error: Could not set the fifth kernel argument";
 const char *const CL_ERROR_ENQUEUE_TRDB = "Error: Could not enqueue the OpenCL object containing the training database";
 const char *const CL_ERROR_ENQUEUE_CENTROIDS = "Error: Could not enqueue the OpenCL object containing the init centroids";
 const char *const CL_ERROR_OBJECT_TTRDB = "Error: Could not create the OpenCL object containing the transposed training database";
 const char *const CL_ERROR_ENQUEUE_TTRDB = "Error: Could not enqueue the OpenCL object containing the transposed training database";
 const char *const CL_ERROR_KERNEL_ARGUMENT6 = "Error: Could not set the sixth kernel argument";
+const char *const CL_ERROR_OBJECT_ITERATIONS = "Error: Could not create the OpenCL object containing the iterations of K-means";
+const char *const CL_ERROR_KERNEL_ARGUMENT7 = "Error: Could not set the seventh kernel argument";
+const char *const CL_ERROR_OBJECT_FITNESS = "Error: Could not create the OpenCL object containing the fitness of the individuals";
+const char *const CL_ERROR_KERNEL_ARGUMENT8 = "Error: Could not set the eighth kernel argument";
 const char *const CL_ERROR_DEVICE_FOUND = "Error: Not exists the specified device";
+const char *const CL_WARNING_CACHE_WRITE = "Warning: Could not write the program binary cache";
+const char *const CL_ERROR_KERNEL_WORKGROUP = "Error: Could not get the maximum work-group size of the kernel";
+const char *const CL_ERROR_ENQUEUE_TUNING = "Error: Could not enqueue the OpenCL object containing the synthetic population";
+const char *const CL_ERROR_PROFILING = "Error: Could not get the profiling information of the kernel";
+const char *const CL_ERROR_TUNING_FAILED = "Error: The kernel could not run with any number of work-groups and work-items on the device";
+const char *const CL_WARNING_TUNING_WRITE = "Warning: Could not write the tuning profile";
+
+/********************************* Defines ********************************/
+
+/**
+ * @brief Program binary cache format: signature and extension of the cached files
+ */
+#define CL_BINARY_MAGIC "HPMOONCL"
+#define CL_CACHE_EXTENSION ".clbin"
+
+/**
+ * @brief Auto-tuner: timed runs of the kernel for each candidate (after a warm-up run) and largest multiple of the compute units of the device tried as number of work-groups
+ */
+#define CL_TUNING_REPETITIONS 3
+#define CL_TUNING_MAX_GROUPS_FACTOR 8
 
 /********************************* Structures ********************************/
 
@@ -78,16 +105,26 @@ typedef struct CLDevice
 	 */
 	cl_device_type deviceType;
 
+	/**
+	 * @brief If the device is driven through OpenCL. Otherwise, it is the CPU evaluating with OpenMP threads
+	 */
+	bool isOpenCL;
+
 	/**
 	 * @brief The context associated to the device
 	 */
 	cl_context context;
 
 	/**
-	 * @brief The command queue which contains the tasks (reads/writes on the device...)
+	 * @brief The command queue which contains the kernels
 	 */
 	cl_command_queue commandQueue;
 
+	/**
+	 * @brief The command queue which contains the transfers of the individuals and the fitness, so they overlap with the kernels
+	 */
+	cl_command_queue transferQueue;
+
 	/**
 	 * @brief The OpenCL kernel with the implementation of K-means
 	 */
@@ -104,15 +141,35 @@ typedef struct CLDevice
 	cl_mem objSelInstances;
 
 	/**
-	 * @brief OpenCL object which contains the current subpopulations
+	 * @brief OpenCL object which contains the chromosomes of the current subpopulations
 	 */
-	cl_mem objSubpopulations;
+	cl_mem objChromosomes;
+
+	/**
+	 * @brief OpenCL object which contains the fitness computed for each individual
+	 */
+	cl_mem objFitness;
 
 	/**
 	 * @brief OpenCL object which contains the transposed training database
 	 */
 	cl_mem objTransposedTrDataBase;
 
+	/**
+	 * @brief OpenCL object which contains the number of iterations executed by K-means for each individual
+	 */
+	cl_mem objIterations;
+
+	/**
+	 * @brief Host buffer where the fitness of the chunks is read back. It has two halves of 'familySize' individuals, one for the chunk being read and one for the chunk in flight
+	 */
+	float *hostFitness;
+
+	/**
+	 * @brief Host buffer where the iterations of K-means of the chunks are read back, split in two halves like 'hostFitness'
+	 */
+	int *hostIterations;
+
 	/**
 	 * @brief The number of compute units specified for this device
 	 */
@@ -133,6 +190,11 @@ typedef struct CLDevice
 	 */
 	std::string deviceName;
 
+	/**
+	 * @brief Individuals per second evaluated in the last chunks (0 if not measured yet). It is kept across generations to size the chunks of the device
+	 */
+	double throughput;
+
 	/********************************* Methods ********************************/
 
 	/**
@@ -154,6 +216,16 @@ typedef struct CLDevice
  */
 CLDevice *createDevices(const float *const trDataBase, const int *const selInstances, const float *const transposedTrDataBase, Config *const conf);
 
+/**
+ * @brief Tunes the number of work-groups ('ComputeUnits') and local work-items ('WiLocal') of each OpenCL device
+ *
+ * The kernel is timed with profiling events on a synthetic population with the dimensions of the configuration. The best
+ * values replace the configured ones and are written to the tuning profile, which 'createDevices' loads in later runs
+ * @param devices The objects containing the OpenCL variables of each device
+ * @param conf The structure with all configuration parameters
+ */
+void tuneDevices(CLDevice *const devices, const Config *const conf);
+
 /**
  * @brief Gets the IDs of all available OpenCL devices
  * @return A vector containing the IDs of all devices
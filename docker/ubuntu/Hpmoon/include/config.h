@@ -41,6 +41,51 @@ const char *const CFG_ERROR_WI_LOWER = "Error: Specified lower number of local w
 const char *const CFG_ERROR_THREADS_MIN = "Error: The number of CPU threads must be 0 or higher if the number of devices is 0, or 1 otherwise";
 const char *const CFG_ERROR_FEATURES_MIN = "Error: The number of features must be 4 or higher";
 const char *const CFG_ERROR_SIZE_MIN = "Error: The minimum number of MPI processes must be 1 or higher";
+const char *const CFG_ERROR_CACHE_SIZE = "Error: The size of the fitness cache must be 0 or higher";
+const char *const CFG_ERROR_ISLAND_MODEL = "Error: The island model must be \'sync\' or \'async\'";
+const char *const CFG_ERROR_TOPOLOGY = "Error: The topology must be \'ring\', \'torus\' or \'random\'";
+const char *const CFG_ERROR_ISA = "Error: The CPU instruction set must be \'auto\', \'scalar\', \'sse4.2\', \'avx2\' or \'avx512\'";
+const char *const CFG_ERROR_CENTROIDS = "Error: The number of centroids must be between 2 and the number of instances (255 at most)";
+const char *const CFG_ERROR_KMEANS_ITERATIONS = "Error: The maximum number of iterations of K-means must be 1 or higher";
+const char *const CFG_ERROR_KMEANS_MODE = "Error: The K-means mode must be \'brute\' or \'elkan\'";
+const char *const CFG_ERROR_DISTRIBUTION = "Error: The distribution of the training database must be \'local\', \'bcast\' or \'shared\'";
+
+/********************************* Defines ********************************/
+
+/**
+ * @brief Ways of distributing the training database to the workers
+ */
+#define TR_DIST_LOCAL 0
+#define TR_DIST_BCAST 1
+#define TR_DIST_SHARED 2
+
+/**
+ * @brief Island models
+ */
+#define ISLANDS_SYNC 0
+#define ISLANDS_ASYNC 1
+
+/**
+ * @brief Migration topologies of the asynchronous island model
+ */
+#define TOPOLOGY_RING 0
+#define TOPOLOGY_TORUS 1
+#define TOPOLOGY_RANDOM 2
+
+/**
+ * @brief Instruction sets of the CPU evaluation
+ */
+#define ISA_AUTO 0
+#define ISA_SCALAR 1
+#define ISA_SSE42 2
+#define ISA_AVX2 3
+#define ISA_AVX512 4
+
+/**
+ * @brief Assignment steps of the CPU K-means
+ */
+#define KMEANS_BRUTE 0
+#define KMEANS_ELKAN 1
 
 /******************************** Structures ******************************/
 
@@ -107,6 +152,21 @@ typedef struct Config
 	 */
 	bool trNormalize;
 
+	/**
+	 * @brief The parameter indicating if a text training database must be cached in binary format
+	 */
+	bool trCache;
+
+	/**
+	 * @brief The parameter indicating how the workers get the training database (TR_DIST_LOCAL, TR_DIST_BCAST or TR_DIST_SHARED)
+	 */
+	int trDistribution;
+
+	/**
+	 * @brief The parameter indicating the name of the binary file to which the training database is converted. Empty if no conversion is required
+	 */
+	std::string trConvFileName;
+
 	/**
 	 * @brief The parameter indicating the number of individuals competing in the tournament
 	 */
@@ -137,12 +197,55 @@ typedef struct Config
 	 */
 	std::string kernelsFileName;
 
+	/**
+	 * @brief The parameter indicating the directory where the compiled OpenCL programs are cached. Empty if they are always compiled from source
+	 */
+	std::string kernelsCacheDir;
+
+	/**
+	 * @brief The parameter indicating the name of the file containing the tuned work-groups and work-items of the OpenCL devices. Empty if the configured values are always used
+	 */
+	std::string tuningProfile;
+
+	/**
+	 * @brief The parameter indicating if the OpenCL devices must be tuned instead of running the algorithm
+	 */
+	bool tune;
+
 	/**
 	 * @brief The parameter indicating the number of OpenMP threads to perform the evaluation of the individuals
 	 */
 	int ompThreads;
 
-	/********************************* Internal parameters ********************************/
+	/**
+	 * @brief The parameter indicating the maximum number of chromosomes stored in the fitness cache (0 to disable it)
+	 */
+	int fitnessCacheSize;
+
+	/**
+	 * @brief The parameter indicating the seed of the run. All random streams (islands, migrations, centroids...) are derived from it
+	 */
+	unsigned int seed;
+
+	/**
+	 * @brief The parameter indicating the island model (ISLANDS_SYNC or ISLANDS_ASYNC)
+	 */
+	int islandModel;
+
+	/**
+	 * @brief The parameter indicating the migration topology of the asynchronous island model (TOPOLOGY_RING, TOPOLOGY_TORUS or TOPOLOGY_RANDOM)
+	 */
+	int topology;
+
+	/**
+	 * @brief The parameter indicating the instruction set of the CPU evaluation (ISA_AUTO, ISA_SCALAR, ISA_SSE42, ISA_AVX2 or ISA_AVX512)
+	 */
+	int cpuIsa;
+
+	/**
+	 * @brief The parameter indicating how the CPU K-means assigns the instances (KMEANS_BRUTE or KMEANS_ELKAN)
+	 */
+	int kmeansMode;
 
 	/**
 	 * @brief The parameter indicating the number of centroids (clusters) for K-means algorithm
@@ -154,6 +257,8 @@ typedef struct Config
 	 */
 	int maxIterKmeans;
 
+	/********************************* Internal parameters ********************************/
+
 	/**
 	 * @brief The parameter indicating the size of the pool (the half of the subpopulation size)
 	 */
@@ -179,6 +284,16 @@ typedef struct Config
 	 */
 	int nFeatures;
 
+	/**
+	 * @brief The parameter indicating the number of 64-bit words of a chromosome (one bit per feature)
+	 */
+	int nWords;
+
+	/**
+	 * @brief The parameter indicating the size in bytes of an individual, including its chromosome
+	 */
+	int individualSize;
+
 	/**
 	 * @brief The parameter indicating the number of objectives
 	 */
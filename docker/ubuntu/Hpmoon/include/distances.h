@@ -0,0 +1,73 @@
+/**
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE', which is part of Hpmoon repository.
+ *
+ * This work has been funded by:
+ *
+ * Spanish 'Ministerio de Economía y Competitividad' under grants number TIN2012-32039 and TIN2015-67020-P.\n
+ * Spanish 'Ministerio de Ciencia, Innovación y Universidades' under grant number PGC2018-098813-B-C31.\n
+ * European Regional Development Fund (ERDF).
+ *
+ * @file distances.h
+ * @author agent
+ * @date 17/10/2026
+ * @brief Function declarations of the vectorized K-means distance kernels for CPU
+ * @copyright Hpmoon (c) 2015 EFFICOMP
+ */
+
+#ifndef DISTANCES_H
+#define DISTANCES_H
+
+/********************************* Includes *******************************/
+
+#include "config.h" // 'Config' datatype
+
+/******************************** Constants *******************************/
+
+const char *const DS_ERROR_ISA_UNSUPPORTED = "Error: The instruction set requested for the CPU evaluation is not supported by this CPU";
+
+/**
+ * @brief Maximum relative difference between the fitness computed by the vector kernels and by the scalar one
+ *
+ * The vector kernels add the squared differences in a different order (one partial sum per lane), so the distances
+ * differ from the scalar ones in rounding. In the WCSS and ICSS it stays below this bound with thousands of features
+ */
+const float DS_TOLERANCE = 1e-5f;
+
+/**
+ * @brief Maximum number of centroids with specialized kernels. The kernels of more centroids get it at runtime
+ *
+ * A kernel specialized for K centroids must only be called with K centroids
+ */
+const int DS_MAX_FIXED_K = 8;
+
+/******************************** Datatypes *******************************/
+
+/**
+ * @brief Kernel which computes the squared Euclidean distances between an instance and all centroids
+ * @param instance The selected features of the instance
+ * @param centroids The centroids, one after another
+ * @param K The number of centroids
+ * @param nSel The number of selected features
+ * @param distances Where the K distances are stored
+ */
+typedef void (*DistancesKernel)(const float *const instance, const float *const centroids, const int K, const int nSel, float *const distances);
+
+/********************************* Methods ********************************/
+
+/**
+ * @brief Selects the distance kernel for the instruction set of the configuration. With ISA_AUTO, the best one supported by the CPU is used
+ * @param K The number of centroids of each call to the kernel. The kernels specialized for it are preferred
+ * @param conf The structure with all configuration parameters
+ * @return The distance kernel
+ */
+DistancesKernel selectDistancesKernel(const int K, const Config *const conf);
+
+/**
+ * @brief Gets the name of the instruction set of a distance kernel
+ * @param kernel The distance kernel
+ * @return The name of the instruction set
+ */
+const char *getDistancesKernelName(const DistancesKernel kernel);
+
+#endif
@@ -21,6 +21,7 @@
 /********************************* Includes *******************************/
 
 #include "clUtils.h"
+#include "fitnessCache.h"
 
 /******************************** Constants *******************************/
 
@@ -33,6 +34,15 @@ const char *const EV_ERROR_DATA_OPEN = "Error: An error ocurred opening or writt
 const char *const EV_ERROR_PLOT_OPEN = "Error: An error ocurred opening or writting the plot file";
 const char *const EV_ERROR_OBJECTIVES_NUMBER = "Error: Gnuplot is only available for two objectives by now. Not generated gnuplot file";
 
+/********************************* Defines ********************************/
+
+/**
+ * @brief Chunk scheduler: maximum chunk of an OpenCL kernel, fraction of its share of the remaining individuals taken by a device in each chunk, and weight of the last chunk in the measured throughput
+ */
+#define EV_MAX_CHUNK_OPENCL 10000
+#define EV_GUIDED_FACTOR 2
+#define EV_THROUGHPUT_SMOOTHING 0.3
+
 /********************************* Methods ********************************/
 
 /**
@@ -42,9 +52,10 @@ const char *const EV_ERROR_OBJECTIVES_NUMBER = "Error: Gnuplot is only available
  * @param trDataBase The training database which will contain the instances and the features
  * @param selInstances The instances choosen as initial centroids
  * @param nThreads The number of threads to perform the individuals evaluation
+ * @param arena The scratch arena where the buffers of the threads are stored
  * @param conf The structure with all configuration parameters
  */
-void evaluationCPU(Individual *const subpop, const int nIndividuals, const float *const trDataBase, const int *const selInstances, const int nThreads, const Config *const conf);
+void evaluationCPU(const Subpopulation subpop, const int nIndividuals, const float *const trDataBase, const int *const selInstances, const int nThreads, ScratchArena *const arena, const Config *const conf);
 
 /**
  * @brief Evaluation of each individual on OpenCL devices
@@ -54,9 +65,17 @@ void evaluationCPU(Individual *const subpop, const int nIndividuals, const float
  * @param nDevices The number of devices that will execute the evaluation
  * @param trDataBase The training database which will contain the instances and the features
  * @param selInstances The instances choosen as initial centroids
+ * @param fitnessCache The cache with the raw fitness of the already evaluated chromosomes (NULL if disabled)
+ * @param arena The scratch arena of the island, used by the CPU evaluation
+ * @param conf The structure with all configuration parameters
+ */
+void evaluation(const Subpopulation subpop, const int nIndividuals, CLDevice *const devicesObject, const int nDevices, const float *const trDataBase, const int *const selInstances, FitnessCache *const fitnessCache, ScratchArena *const arena, const Config *const conf);
+
+/**
+ * @brief Prints the histogram of the iterations executed by K-means in this process
  * @param conf The structure with all configuration parameters
  */
-void evaluation(Individual *const subpop, const int nIndividuals, CLDevice *const devicesObject, const int nDevices, const float *const trDataBase, const int *const selInstances, const Config *const conf);
+void printKmeansStats(const Config *const conf);
 
 /**
  * @brief Normalize the fitness for each individual
@@ -64,16 +83,17 @@ void evaluation(Individual *const subpop, const int nIndividuals, CLDevice *cons
  * @param nIndividuals The number of individuals which will be normalized
  * @param conf The structure with all configuration parameters
  */
-void normalizeFitness(Individual *const subpop, const int nIndividuals, const Config *const conf);
+void normalizeFitness(const Subpopulation subpop, const int nIndividuals, const Config *const conf);
 
 /**
  * @brief Gets the hypervolume measure of the subpopulation
  * @param subpop Current subpopulation
  * @param nIndFront0 The number of individuals in the front 0
+ * @param arena The scratch arena where the points are stored
  * @param conf The structure with all configuration parameters
  * @return The value of the hypervolume
  */
-float getHypervolume(const Individual *const subpop, const int nIndFront0, const Config *const conf);
+float getHypervolume(const Subpopulation subpop, const int nIndFront0, ScratchArena *const arena, const Config *const conf);
 
 /**
  * @brief Gets the initial centroids (instances choosen randomly)
@@ -88,7 +108,7 @@ int *getCentroids(const Config *const conf);
  * @param nIndFront0 The number of individuals in the front 0
  * @param conf The structure with all configuration parameters
  */
-void generateDataPlot(const Individual *const subpop, const int nIndFront0, const Config *const conf);
+void generateDataPlot(const Subpopulation subpop, const int nIndFront0, const Config *const conf);
 
 /**
  * @brief Generates gnuplot code for data display
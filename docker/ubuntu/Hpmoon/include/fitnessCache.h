@@ -0,0 +1,206 @@
+/**
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE', which is part of Hpmoon repository.
+ *
+ * This work has been funded by:
+ *
+ * Spanish 'Ministerio de Economía y Competitividad' under grants number TIN2012-32039 and TIN2015-67020-P.\n
+ * Spanish 'Ministerio de Ciencia, Innovación y Universidades' under grant number PGC2018-098813-B-C31.\n
+ * European Regional Development Fund (ERDF).
+ *
+ * @file fitnessCache.h
+ * @author agent
+ * @date 17/10/2026
+ * @brief Function declarations of the fitness memoization cache
+ * @copyright Hpmoon (c) 2015 EFFICOMP
+ */
+
+#ifndef FITNESSCACHE_H
+#define FITNESSCACHE_H
+
+/********************************* Includes *******************************/
+
+#include "individual.h" // Individual
+#include <omp.h>		// omp_lock_t
+#include <stddef.h>		// size_t
+
+/******************************** Structures ******************************/
+
+/**
+ * @brief Structure containing the raw fitness of an evaluated chromosome. The entries are linked from the most to the
+ * least recently used
+ */
+typedef struct CacheEntry
+{
+
+	/**
+	 * @brief Hash of the chromosome
+	 */
+	uint64_t hash;
+
+	/**
+	 * @brief Raw fitness (before normalization) of the chromosome
+	 */
+	float fitness[2];
+
+	/**
+	 * @brief The previous (more recently used) entry, or -1 if it is the most recently used
+	 */
+	int prev;
+
+	/**
+	 * @brief The next (less recently used) entry, or -1 if it is the least recently used
+	 */
+	int next;
+
+} CacheEntry;
+
+/**
+ * @brief Structure containing a thread-safe LRU cache with the raw fitness of the evaluated chromosomes
+ *
+ * All the memory is allocated by the constructor, and the evicted entries are recycled, so looking up and inserting
+ * never reach the heap
+ */
+typedef struct FitnessCache
+{
+
+	/**
+	 * @brief The maximum number of entries. The least recently used entry is evicted when it is exceeded
+	 */
+	int capacity;
+
+	/**
+	 * @brief The number of words of the chromosomes
+	 */
+	int nWords;
+
+	/**
+	 * @brief Number of lookups that found the chromosome
+	 */
+	long int hits;
+
+	/**
+	 * @brief Number of lookups that did not find the chromosome
+	 */
+	long int misses;
+
+	/**
+	 * @brief Number of entries evicted because the cache was full
+	 */
+	long int evictions;
+
+	/**
+	 * @brief The number of entries in use
+	 */
+	int nEntries;
+
+	/**
+	 * @brief The most recently used entry, or -1 if the cache is empty
+	 */
+	int head;
+
+	/**
+	 * @brief The least recently used entry, or -1 if the cache is empty
+	 */
+	int tail;
+
+	/**
+	 * @brief The entries ('capacity' elements)
+	 */
+	CacheEntry *entries;
+
+	/**
+	 * @brief Copy of the chromosome of each entry ('nWords' words per entry), used to discard hash collisions
+	 */
+	uint64_t *chromosomes;
+
+	/**
+	 * @brief Index of the entries by chromosome hash, with open addressing and linear probing. The free slots are -1.
+	 * It has at least twice as many slots as entries, so the probe sequences are short
+	 */
+	int *index;
+
+	/**
+	 * @brief The number of slots of the index minus 1 (the number of slots is a power of 2)
+	 */
+	size_t indexMask;
+
+	/**
+	 * @brief Lock protecting the cache, since the islands evaluate concurrently
+	 */
+	omp_lock_t lock;
+
+	/********************************* Methods ********************************/
+
+	/**
+	 * @brief The constructor with parameters
+	 * @param conf The structure with all configuration parameters
+	 * @return An empty cache
+	 */
+	FitnessCache(const Config *const conf);
+
+	/**
+	 * @brief The destructor
+	 */
+	~FitnessCache();
+
+	/**
+	 * @brief The cache owns its memory, so it can not be copied
+	 */
+	FitnessCache(const FitnessCache &) = delete;
+	FitnessCache &operator=(const FitnessCache &) = delete;
+
+	/**
+	 * @brief Looks for the raw fitness of a chromosome
+	 * @param chromosome The bit-packed chromosome
+	 * @param fitness Where the raw fitness is stored if the chromosome is found
+	 * @return true if the chromosome is found
+	 */
+	bool lookup(const uint64_t *const chromosome, float *const fitness);
+
+	/**
+	 * @brief Stores the raw fitness of a chromosome
+	 * @param chromosome The bit-packed chromosome
+	 * @param fitness The raw fitness of the chromosome
+	 */
+	void insert(const uint64_t *const chromosome, const float *const fitness);
+
+	/**
+	 * @brief Prints the hit/miss counters of the cache
+	 * @param conf The structure with all configuration parameters
+	 */
+	void printStats(const Config *const conf);
+
+	/**
+	 * @brief Gets the slot of the index which holds a hash, or the free slot where it would be inserted
+	 * @param hash The hash of the chromosome
+	 * @return The slot
+	 */
+	size_t findSlot(const uint64_t hash) const;
+
+	/**
+	 * @brief Frees a slot of the index. The following slots of the probe sequence are shifted back to fill the gap
+	 * @param slot The slot
+	 */
+	void eraseSlot(size_t slot);
+
+	/**
+	 * @brief Makes an entry the most recently used one
+	 * @param entry The entry
+	 * @param linked false if the entry is new, so it is not in the list yet
+	 */
+	void moveToFront(const int entry, const bool linked);
+
+} FitnessCache;
+
+/********************************* Methods ********************************/
+
+/**
+ * @brief Gets the hash of a chromosome
+ * @param chromosome The bit-packed chromosome
+ * @param nWords The number of words of the chromosome
+ * @return The 64-bit hash
+ */
+uint64_t hashChromosome(const uint64_t *const chromosome, const int nWords);
+
+#endif
@@ -20,23 +20,26 @@
 
 /********************************** Includes *********************************/
 
+#include "arena.h"  // 'ScratchArena' datatype
 #include "config.h" // 'Config' datatype
+#include <stdint.h> // uint64_t
+
+/******************************** Constants *******************************/
+
+const char *const IND_ERROR_POPULATION_ALLOC = "Error: Could not allocate the chromosomes of the population";
 
 /********************************* Structures ********************************/
 
 /**
- * @brief Structure containing the Individual's parameters
+ * @brief Structure containing the Individual's parameters as a single record
+ *
+ * The populations are stored as structures of arrays ('Population'). This record is only used to send individuals
+ * between MPI processes. The chromosome length is only known at runtime, so the records take 'conf -> individualSize'
+ * bytes and must be accessed through 'getIndividual' instead of the array subscript
  */
 typedef struct Individual
 {
 
-	/**
-	 * @brief Vector denoting the selected features
-	 *
-	 * Values: Zeros or ones
-	 */
-	unsigned char chromosome[N_FEATURES];
-
 	/**
 	 * @brief Individual fitness for the multi-objective functions
 	 *
@@ -61,96 +64,437 @@ typedef struct Individual
 	 */
 	int nSelFeatures;
 
+	/**
+	 * @brief Bit-packed vector denoting the selected features. It has 'conf -> nWords' words
+	 *
+	 * Feature 'f' is stored in the bit 'f % 64' of the word 'f / 64'. Bits beyond 'conf -> nFeatures' are always zero
+	 */
+	uint64_t chromosome[];
+
 } Individual;
 
 /**
- * @brief Structure that contains a comparator to sort individuals according to their ranks
+ * @brief View of consecutive individuals of a population. It does not own the data, so it is passed by value
+ *
+ * The individual 'i' of the view is made up of the position 'i' of each array
  */
-struct rankCompare
+typedef struct Subpopulation
 {
 
 	/**
-	 * @brief Compare individuals according to their ranks
-	 * @param ind1 The first individual
-	 * @param ind2 The second individual
-	 * @return true if the rank of the first individual is lower than the rank of the second individual
+	 * @brief Bit-packed chromosomes, one after another. Each one has 'nWords' words
 	 */
-	bool operator()(const Individual &ind1, const Individual &ind2) const
+	uint64_t *chromosomes;
+
+	/**
+	 * @brief Fitness of the individuals for each objective function
+	 */
+	float *fitness[2];
+
+	/**
+	 * @brief Crowding distance of each individual
+	 */
+	float *crowding;
+
+	/**
+	 * @brief Range (Pareto front) of each individual
+	 */
+	int *rank;
+
+	/**
+	 * @brief Number of selected features of each individual
+	 */
+	int *nSelFeatures;
+
+	/**
+	 * @brief Number of 64-bit words of a chromosome
+	 */
+	int nWords;
+
+	/**
+	 * @brief Gets the chromosome of an individual
+	 * @param i The index of the individual in the view
+	 * @return The bit-packed chromosome
+	 */
+	uint64_t *chromosome(const int i) const
 	{
-		return ind1.rank < ind2.rank;
+		return this->chromosomes + (size_t)i * this->nWords;
 	}
-};
+
+	/**
+	 * @brief Gets a view which starts at an individual of this view
+	 * @param first The index of the first individual of the new view
+	 * @return The new view
+	 */
+	Subpopulation from(const int first) const
+	{
+		Subpopulation view = *this;
+		view.chromosomes += (size_t)first * this->nWords;
+		view.fitness[0] += first;
+		view.fitness[1] += first;
+		view.crowding += first;
+		view.rank += first;
+		view.nSelFeatures += first;
+		return view;
+	}
+
+} Subpopulation;
 
 /**
- * @brief Structure that contains a function to sort individuals by fitness (objective function)
+ * @brief Structure containing a population stored as a structure of arrays
  *
- * The attribute 'objective' specifies which objective function should be compared
+ * The chromosomes are kept in a single aligned block, and the fitness, ranks, crowding distances and number of selected
+ * features in separate dense arrays. So the phases which only use the small fields (sorting, normalization...) do not
+ * stride through the chromosomes
+ */
+typedef struct Population
+{
+
+	/**
+	 * @brief Bit-packed chromosomes of all individuals, aligned to a cache line
+	 */
+	uint64_t *chromosomes;
+
+	/**
+	 * @brief Fitness of all individuals stored by objective: 'fitness[obj * nIndividuals + i]'
+	 */
+	float *fitness;
+
+	/**
+	 * @brief Crowding distance of each individual
+	 */
+	float *crowding;
+
+	/**
+	 * @brief Range (Pareto front) of each individual
+	 */
+	int *rank;
+
+	/**
+	 * @brief Number of selected features of each individual
+	 */
+	int *nSelFeatures;
+
+	/**
+	 * @brief Number of individuals
+	 */
+	int nIndividuals;
+
+	/**
+	 * @brief Number of 64-bit words of a chromosome
+	 */
+	int nWords;
+
+	/********************************* Methods ********************************/
+
+	/**
+	 * @brief The constructor with parameters. All chromosomes, fitness and crowding distances are set to zero and all ranks to -1
+	 * @param nIndividuals The number of individuals
+	 * @param conf The structure with all configuration parameters
+	 * @return An object containing the population
+	 */
+	Population(const int nIndividuals, const Config *const conf);
+
+	/**
+	 * @brief The destructor
+	 */
+	~Population();
+
+	/**
+	 * @brief The population owns its arrays, so it can not be copied
+	 */
+	Population(const Population &) = delete;
+	Population &operator=(const Population &) = delete;
+
+	/**
+	 * @brief Gets a view of the population
+	 * @param first The index of the first individual of the view
+	 * @return The view
+	 */
+	Subpopulation view(const int first) const;
+
+} Population;
+
+/**
+ * @brief Structure of arrays with the data used by the non-dominated sorting
+ *
+ * Ranks and crowding distances are computed on these compact arrays, so the individuals (and their chromosomes) are only moved once at the end
+ */
+typedef struct SortingData
+{
+
+	/**
+	 * @brief Fitness of the individuals stored by objective: 'fitness[obj * nIndividuals + i]'
+	 */
+	float *fitness;
+
+	/**
+	 * @brief Crowding distance of each individual
+	 */
+	float *crowding;
+
+	/**
+	 * @brief Range (Pareto front) of each individual
+	 */
+	int *rank;
+
+	/**
+	 * @brief Indexes of the individuals. At the end, the final position of each individual
+	 */
+	int *index;
+
+	/**
+	 * @brief Number of individuals
+	 */
+	int nIndividuals;
+
+} SortingData;
+
+/**
+ * @brief Structure that contains a function to sort individual indexes by fitness (objective function)
  */
 struct objectiveCompare
 {
 
 	/**
-	 * @brief The objective function which should be compared
+	 * @brief The fitness of all individuals for the objective function which should be compared
 	 */
-	unsigned char objective;
+	const float *fitness;
 
 	/**
 	 * @brief Constructor
-	 * @param objective The objective function which should be compared
+	 * @param fitness The fitness of all individuals for the objective function which should be compared
 	 */
-	objectiveCompare(unsigned char objective)
+	objectiveCompare(const float *const fitness)
 	{
-		this->objective = objective;
+		this->fitness = fitness;
 	}
 
 	/**
 	 * @brief Compare individuals according to their objectives
-	 * @param ind1 The first individual
-	 * @param ind2 The second individual
+	 * @param ind1 The index of the first individual
+	 * @param ind2 The index of the second individual
 	 * @return true if the fitness of the first individual is lower than the fitness of the second individual
 	 */
-	bool operator()(const Individual &ind1, const Individual &ind2) const
+	bool operator()(const int ind1, const int ind2) const
+	{
+		return this->fitness[ind1] < this->fitness[ind2];
+	}
+};
+
+/**
+ * @brief Structure that contains a function to sort individual indexes lexicographically by their objectives
+ */
+struct lexicographicCompare
+{
+
+	/**
+	 * @brief The sorting data with the fitness of the individuals
+	 */
+	const SortingData *data;
+
+	/**
+	 * @brief The number of objectives
+	 */
+	unsigned char nObjectives;
+
+	/**
+	 * @brief Constructor
+	 * @param data The sorting data with the fitness of the individuals
+	 * @param nObjectives The number of objectives
+	 */
+	lexicographicCompare(const SortingData *const data, const unsigned char nObjectives)
 	{
-		return ind1.fitness[this->objective] < ind2.fitness[this->objective];
+		this->data = data;
+		this->nObjectives = nObjectives;
+	}
+
+	/**
+	 * @brief Compare individuals lexicographically by their objectives. Ties are resolved by index
+	 * @param ind1 The index of the first individual
+	 * @param ind2 The index of the second individual
+	 * @return true if the first individual goes before the second one
+	 */
+	bool operator()(const int ind1, const int ind2) const
+	{
+		const int nIndividuals = this->data->nIndividuals;
+		for (unsigned char obj = 0; obj < this->nObjectives; ++obj)
+		{
+			float fit1 = this->data->fitness[obj * nIndividuals + ind1];
+			float fit2 = this->data->fitness[obj * nIndividuals + ind2];
+			if (fit1 != fit2)
+			{
+				return fit1 < fit2;
+			}
+		}
+		return ind1 < ind2;
 	}
 };
 
 /**
- * @brief Structure that contains a function to sort individuals by rank and crowding distance
+ * @brief Structure that contains a function to sort individual indexes by rank and crowding distance
  *
  * If both individuals have the same rank, the crowding distance will be compared
  */
 struct rankAndCrowdingCompare
 {
 
+	/**
+	 * @brief The sorting data with the ranks and crowding distances of the individuals
+	 */
+	const SortingData *data;
+
+	/**
+	 * @brief Constructor
+	 * @param data The sorting data with the ranks and crowding distances of the individuals
+	 */
+	rankAndCrowdingCompare(const SortingData *const data)
+	{
+		this->data = data;
+	}
+
 	/**
 	 * @brief Compare individuals according to their ranks and their crowding distances
-	 * @param ind1 The first individual
-	 * @param ind2 The second individual
-	 * @return true if the rank of the first individual is lower than the rank of the second individual. If both individuals have the same rank, the crowding distance will be compared
+	 * @param ind1 The index of the first individual
+	 * @param ind2 The index of the second individual
+	 * @return true if the rank of the first individual is lower than the rank of the second individual. If both individuals have the same rank, the crowding distance will be compared. Remaining ties are resolved by index
 	 */
-	bool operator()(const Individual &ind1, const Individual &ind2) const
+	bool operator()(const int ind1, const int ind2) const
 	{
-		if (ind1.rank == ind2.rank)
+		if (this->data->rank[ind1] != this->data->rank[ind2])
 		{
-			return ind1.crowding > ind2.crowding;
+			return this->data->rank[ind1] < this->data->rank[ind2];
+		}
+		else if (this->data->crowding[ind1] != this->data->crowding[ind2])
+		{
+			return this->data->crowding[ind1] > this->data->crowding[ind2];
 		}
 		else
 		{
-			return ind1.rank < ind2.rank;
+			return ind1 < ind2;
 		}
 	}
 };
 
 /********************************* Methods ********************************/
 
+/**
+ * @brief Checks if a feature is selected in the chromosome
+ * @param chromosome The bit-packed chromosome
+ * @param f The feature index
+ * @return true if the feature is selected
+ */
+inline bool isSelected(const uint64_t *const chromosome, const int f)
+{
+	return (chromosome[f >> 6] >> (f & 63)) & 1;
+}
+
+/**
+ * @brief Selects a feature in the chromosome
+ * @param chromosome The bit-packed chromosome
+ * @param f The feature index
+ */
+inline void selectFeature(uint64_t *const chromosome, const int f)
+{
+	chromosome[f >> 6] |= (uint64_t)1 << (f & 63);
+}
+
+/**
+ * @brief Counts the number of selected features in the chromosome
+ * @param chromosome The bit-packed chromosome
+ * @param nWords The number of words of the chromosome
+ * @return The number of bits set to '1'
+ */
+inline int countSelected(const uint64_t *const chromosome, const int nWords)
+{
+	int nSelFeatures = 0;
+	for (int w = 0; w < nWords; ++w)
+	{
+		nSelFeatures += __builtin_popcountll(chromosome[w]);
+	}
+	return nSelFeatures;
+}
+
+/**
+ * @brief Gets an individual of an array of records
+ * @param individuals The array of records
+ * @param i The index of the individual
+ * @param conf The structure with all configuration parameters
+ * @return The address of the individual
+ */
+inline Individual *getIndividual(Individual *const individuals, const int i, const Config *const conf)
+{
+	return (Individual *)((char *)individuals + (size_t)i * conf->individualSize);
+}
+
+/**
+ * @brief Gets an individual of an array of records
+ * @param individuals The array of records
+ * @param i The index of the individual
+ * @param conf The structure with all configuration parameters
+ * @return The address of the individual
+ */
+inline const Individual *getIndividual(const Individual *const individuals, const int i, const Config *const conf)
+{
+	return (const Individual *)((const char *)individuals + (size_t)i * conf->individualSize);
+}
+
+/**
+ * @brief Allocates an array of records. All the fields and chromosomes are set to zero
+ * @param nIndividuals The number of individuals
+ * @param conf The structure with all configuration parameters
+ * @return The array of records
+ */
+Individual *createIndividuals(const int nIndividuals, const Config *const conf);
+
+/**
+ * @brief Releases an array of records allocated with 'createIndividuals'
+ * @param individuals The array of records
+ */
+void deleteIndividuals(Individual *const individuals);
+
+/**
+ * @brief Copies consecutive individuals between two views. The views must not overlap
+ * @param dest The destination view
+ * @param src The source view
+ * @param nIndividuals The number of individuals to be copied
+ */
+void copyIndividuals(const Subpopulation dest, const Subpopulation src, const int nIndividuals);
+
+/**
+ * @brief Swaps two individuals of a view
+ * @param subpop The view
+ * @param i The index of the first individual
+ * @param j The index of the second individual
+ */
+void swapIndividuals(const Subpopulation subpop, const int i, const int j);
+
+/**
+ * @brief Packs consecutive individuals of a view into records, so they can be sent to another process
+ * @param subpop The view
+ * @param nIndividuals The number of individuals to be packed
+ * @param records Where the records are stored
+ * @param conf The structure with all configuration parameters
+ */
+void packIndividuals(const Subpopulation subpop, const int nIndividuals, Individual *const records, const Config *const conf);
+
+/**
+ * @brief Unpacks records into consecutive individuals of a view
+ * @param records The records
+ * @param nIndividuals The number of individuals to be unpacked
+ * @param subpop The view
+ * @param conf The structure with all configuration parameters
+ */
+void unpackIndividuals(const Individual *const records, const int nIndividuals, const Subpopulation subpop, const Config *const conf);
+
 /**
  * @brief Perform non-dominated sorting on the subpopulation
  * @param subpop Current subpopulation
  * @param nIndividuals The number of individuals which will be sorted
+ * @param arena The scratch arena where the temporaries are stored
  * @param conf The structure with all configuration parameters
  * @return The number of individuals in the front 0
  */
-int nonDominationSort(Individual *const subpop, const int nIndividuals, const Config *const conf);
+int nonDominationSort(const Subpopulation subpop, const int nIndividuals, ScratchArena *const arena, const Config *const conf);
 
 #endif
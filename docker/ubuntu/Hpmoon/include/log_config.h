@@ -1,3 +1,7 @@
 // 0: logging disabled
 // 1: logging enabled
-#define LOG_ENABLED 0
\ No newline at end of file
+#define LOG_ENABLED 0
+
+// 0: heap allocation counter disabled
+// 1: heap allocation counter enabled (operator new is replaced and the allocations of the generations are reported)
+#define ALLOCATION_COUNTER_ENABLED 0
@@ -0,0 +1,148 @@
+/**
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE', which is part of Hpmoon repository.
+ *
+ * This work has been funded by:
+ *
+ * Spanish 'Ministerio de Economía y Competitividad' under grants number TIN2012-32039 and TIN2015-67020-P.\n
+ * Spanish 'Ministerio de Ciencia, Innovación y Universidades' under grant number PGC2018-098813-B-C31.\n
+ * European Regional Development Fund (ERDF).
+ *
+ * @file random.h
+ * @author agent
+ * @date 17/10/2026
+ * @brief Counter-based random number generator used by the genetic operators
+ * @copyright Hpmoon (c) 2015 EFFICOMP
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+/********************************* Includes *******************************/
+
+#include <stdint.h> // uint64_t
+#include <math.h>	// log
+
+/********************************* Defines ********************************/
+
+/**
+ * @brief Random streams. Each one is independent of the others for the same seed
+ */
+#define RNG_POPULATION 0
+#define RNG_EVOLUTION 1
+#define RNG_MIGRATION 2
+#define RNG_CENTROIDS 3
+#define RNG_TUNING 4
+
+/******************************** Structures ******************************/
+
+/**
+ * @brief Structure containing a counter-based random number generator
+ *
+ * The n-th number of a stream is a strong mix (SplitMix64 finalizer) of the stream key and 'n'. The key is derived from
+ * the run seed, the purpose of the stream, the island and the epoch (global migration). Thus, each island draws the
+ * same numbers regardless of the thread or MPI process that evolves it, and no state is shared between threads
+ */
+typedef struct RandomGenerator
+{
+
+	/**
+	 * @brief Key of the stream
+	 */
+	uint64_t key;
+
+	/**
+	 * @brief Number of values generated so far
+	 */
+	uint64_t counter;
+
+	/********************************* Methods ********************************/
+
+	/**
+	 * @brief The constructor with parameters
+	 * @param seed The run seed
+	 * @param purpose What the numbers will be used for (RNG_POPULATION, RNG_EVOLUTION...)
+	 * @param island The island (subpopulation) index
+	 * @param epoch The global migration index
+	 * @return A generator at the beginning of the stream
+	 */
+	RandomGenerator(const uint64_t seed, const uint64_t purpose, const uint64_t island, const uint64_t epoch)
+	{
+		this->key = mix(mix(mix(mix(seed) ^ purpose) ^ island) ^ epoch);
+		this->counter = 0;
+	}
+
+	/**
+	 * @brief Mixes the bits of a 64-bit value (SplitMix64 finalizer)
+	 * @param z The value to be mixed
+	 * @return The mixed value
+	 */
+	static uint64_t mix(uint64_t z)
+	{
+		z += 0x9E3779B97F4A7C15ULL;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	/**
+	 * @brief Gets the next 64 random bits
+	 * @return A uniformly distributed 64-bit value
+	 */
+	uint64_t next()
+	{
+		return mix(this->key + (++(this->counter) * 0xD1B54A32D192ED03ULL));
+	}
+
+	/**
+	 * @brief Gets a random integer in the range [0, n)
+	 * @param n The upper bound (exclusive). It must be positive
+	 * @return A uniformly distributed integer (multiply-shift reduction)
+	 */
+	int nextInt(const int n)
+	{
+		return (int)(((this->next() >> 32) * (uint64_t)n) >> 32);
+	}
+
+	/**
+	 * @brief Gets the next random integers at once, each one in the range [0, n). They are the same as 'count' calls to 'nextInt'
+	 * @param values Where the integers are stored
+	 * @param count The number of integers
+	 * @param n The upper bound (exclusive). It must be positive
+	 */
+	void nextInts(int *const values, const int count, const int n)
+	{
+		const uint64_t first = this->counter + 1;
+		const uint64_t key = this->key;
+#pragma omp simd
+		for (int i = 0; i < count; ++i)
+		{
+			values[i] = (int)(((mix(key + (first + i) * 0xD1B54A32D192ED03ULL) >> 32) * (uint64_t)n) >> 32);
+		}
+		this->counter += count;
+	}
+
+	/**
+	 * @brief Gets a random float in the range [0, 1)
+	 * @return A uniformly distributed float with 24 random bits
+	 */
+	float nextFloat()
+	{
+		return (this->next() >> 40) * (1.0f / 16777216.0f);
+	}
+
+	/**
+	 * @brief Gets the number of failed Bernoulli trials before the first success (geometric distribution)
+	 * @param logFailure The natural logarithm of the failure probability of a trial, 'log(1 - p)'. It must be negative
+	 * @return The number of trials that can be skipped (inverse transform sampling with 53 random bits)
+	 */
+	int nextGeometric(const double logFailure)
+	{
+		double u = ((this->next() >> 11) + 1) * (1.0 / 9007199254740992.0);
+		double skip = log(u) / logFailure;
+		return (skip < 1073741824.0) ? (int)skip : 1073741824;
+	}
+
+} RandomGenerator;
+
+#endif
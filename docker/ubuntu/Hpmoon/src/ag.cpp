@@ -20,9 +20,11 @@
 #include "ag.h"
 #include "evaluation.h"
 #include <algorithm>	// std::max_element
+#include <list>			// std::list
+#include <math.h>		// sqrt, log
 #include <numeric>		// std::iota
 #include <omp.h>		// OpenMP
-#include <set>			// std::set
+#include "random.h"		// RandomGenerator
 #include <string.h>		// memcpy, memset
 #include <log_config.h> // LOG_ENABLED
 
@@ -31,10 +33,11 @@
 #define INITIALIZE 0
 #define IGNORE_VALUE 1
 #define FINISH 2
+#define N_MODES 3
 
 /********************************* Methods ********************************/
 
-void printSubpopulations(const Individual *const subpops, const int nSubpopulations, const Config *const conf)
+void printSubpopulations(const Subpopulation subpops, const int nSubpopulations, const Config *const conf)
 {
 
 	for (int sp = 0; sp < nSubpopulations; ++sp)
@@ -45,159 +48,203 @@ void printSubpopulations(const Individual *const subpops, const int nSubpopulati
 			fprintf(stdout, "Process %d: Individual %d: ", conf->mpiRank, i);
 			for (int f = 0; f < conf->nFeatures; ++f)
 			{
-				fprintf(stdout, " %d", subpops[i].chromosome[f]);
+				fprintf(stdout, " %d", isSelected(subpops.chromosome(i), f));
 			}
-			fprintf(stdout, " * Rank: %d", subpops[i].rank);
-			fprintf(stdout, " * Fit0: %f", subpops[sp * conf->familySize + i].fitness[0]);
-			fprintf(stdout, " * Fit1: %f", subpops[sp * conf->familySize + i].fitness[1]);
-			fprintf(stdout, "* Crow: %f", subpops[i].crowding);
+			fprintf(stdout, " * Rank: %d", subpops.rank[i]);
+			fprintf(stdout, " * Fit0: %f", subpops.fitness[0][sp * conf->familySize + i]);
+			fprintf(stdout, " * Fit1: %f", subpops.fitness[1][sp * conf->familySize + i]);
+			fprintf(stdout, "* Crow: %f", subpops.crowding[i]);
 			fprintf(stdout, "\n");
 		}
 	}
 }
 
+/**
+ * @brief Encodes the MPI tag of the messages sent from the master to the workers
+ *
+ * Besides the mode, the tag carries the island and the epoch, so the worker can rebuild the random stream of the island
+ * @param mode The kind of message (INITIALIZE, IGNORE_VALUE or FINISH)
+ * @param island The island (subpopulation) index
+ * @param epoch The global migration index
+ * @param conf The structure with all configuration parameters
+ * @return The MPI tag
+ */
+static int encodeTag(const int mode, const int island, const int epoch, const Config *const conf)
+{
+	return mode + N_MODES * (island + conf->nSubpopulations * epoch);
+}
+
+/**
+ * @brief Counts the individuals in the front 0 of a subpopulation already sorted
+ * @param subpop The subpopulation (parents and children)
+ * @param conf The structure with all configuration parameters
+ * @return The number of individuals in the front 0
+ */
+static int countFront0(const Subpopulation subpop, const Config *const conf)
+{
+	int nIndFront0 = 0;
+	while (nIndFront0 < conf->familySize && subpop.rank[nIndFront0] == 0)
+	{
+		++nIndFront0;
+	}
+	return nIndFront0;
+}
+
 /**
  * @brief Allocate memory for all subpopulations (parents and children). Also, they are initialized
  * @param conf The structure with all configuration parameters
  * @return The first subpopulations
  */
-Individual *createSubpopulations(const Config *const conf)
+Population *createSubpopulations(const Config *const conf)
 {
 
 	/********** Initialization of the subpopulations and the individuals ***********/
 
-	// Allocate memory for parents and children
-	Individual *subpops = new Individual[conf->totalIndividuals];
-	for (int i = 0; i < conf->totalIndividuals; ++i)
-	{
-		memset(subpops[i].chromosome, 0, conf->nFeatures * sizeof(unsigned char));
-		for (unsigned char obj = 0; obj < conf->nObjectives; ++obj)
-		{
-			subpops[i].fitness[obj] = 0.0f;
-		}
-		subpops[i].crowding = 0.0f;
-		subpops[i].rank = -1;
-		subpops[i].nSelFeatures = 0;
-	}
+	// Allocate memory for parents and children. The chromosomes, fitness and crowding distances are zeroed
+	Population *population = new Population(conf->totalIndividuals, conf);
+	Subpopulation subpops = population->view(0);
 
-	// Only the parents of each subpopulation are initialized
+	// Only the parents of each subpopulation are initialized. Each island has its own random stream
 	for (int it = 0; it < conf->totalIndividuals; it += conf->familySize)
 	{
+		RandomGenerator rng(conf->seed, RNG_POPULATION, it / conf->familySize, 0);
 		for (int i = it; i < it + conf->subpopulationSize; ++i)
 		{
+			uint64_t *const chromosome = subpops.chromosome(i);
 
 			// Set value '1' 'conf -> maxFeatures' decision variables at most
 			for (int mf = 0; mf < conf->maxFeatures; ++mf)
 			{
-				int randomFeature = rand() % conf->nFeatures;
-				if (!(subpops[i].chromosome[randomFeature] & 1))
+				int randomFeature = rng.nextInt(conf->nFeatures);
+				if (!isSelected(chromosome, randomFeature))
 				{
-					subpops[i].nSelFeatures += (subpops[i].chromosome[randomFeature] = 1);
+					selectFeature(chromosome, randomFeature);
+					++subpops.nSelFeatures[i];
 				}
 			}
 		}
 	}
 
-	return subpops;
+	return population;
 }
 
 /**
  * @brief Tournament between randomly selected individuals. The best individuals are stored in the pool
+ *
+ * The 'tourSize' distinct candidates of all tournaments are drawn round by round, so each round is a loop over the whole
+ * pool without branches. A draw is an index among the individuals not chosen yet by its tournament, so it is shifted past
+ * the chosen ones, and then inserted in order. The candidates of each tournament are kept sorted
+ * @param rng The random generator of the island
+ * @param arena The scratch arena where the pool is stored
  * @param conf The structure with all configuration parameters
  * @return The pool with the selected individuals
  */
-int *getPool(const Config *const conf)
+int *getPool(RandomGenerator *const rng, ScratchArena *const arena, const Config *const conf)
 {
 
-	// Create and fill the pool
-	int *pool = new int[conf->poolSize];
-	std::set<int> candidates;
-	for (int i = 0; i < conf->poolSize; ++i)
+	// The candidates are stored by round: 'candidates[j * poolSize + i]' is the j-th best candidate of the tournament 'i'
+	const int poolSize = conf->poolSize;
+	int *const candidates = arena->allocate<int>((size_t)conf->tourSize * poolSize);
+	for (int j = 0; j < conf->tourSize; ++j)
 	{
-
-		// std::set guarantees unique elements in the insert function
-		for (int j = 0; j < conf->tourSize; ++j)
+		int *const draws = candidates + (size_t)j * poolSize;
+		rng->nextInts(draws, poolSize, conf->subpopulationSize - j);
+		for (int k = 0; k < j; ++k)
 		{
-			candidates.insert(rand() % conf->subpopulationSize);
+			const int *const chosen = candidates + (size_t)k * poolSize;
+#pragma omp simd
+			for (int i = 0; i < poolSize; ++i)
+			{
+				draws[i] += (chosen[i] <= draws[i]);
+			}
+		}
+		for (int k = 0; k < j; ++k)
+		{
+			int *const chosen = candidates + (size_t)k * poolSize;
+#pragma omp simd
+			for (int i = 0; i < poolSize; ++i)
+			{
+				int lower = std::min(chosen[i], draws[i]);
+				draws[i] = std::max(chosen[i], draws[i]);
+				chosen[i] = lower;
+			}
 		}
-
-		// At this point, the individuals already are sorted by rank and crowding distance
-		// Therefore, lower index is better
-		pool[i] = *(candidates.begin());
-		candidates.clear();
 	}
 
-	return pool;
+	// At this point, the individuals already are sorted by rank and crowding distance
+	// Therefore, lower index is better and the pool is the first round of candidates
+	return candidates;
 }
 
 /**
  * @brief Perform binary crossover between two individuals (uniform crossover)
  * @param subpop Current subpopulation
  * @param pool Position of the selected individuals for the crossover
+ * @param rng The random generator of the island
  * @param conf The structure with all configuration parameters
  * @return The number of generated children
  */
-int crossoverUniform(Individual *const subpop, const int *const pool, const Config *const conf)
+int crossoverUniform(const Subpopulation subpop, const int *const pool, RandomGenerator *const rng, const Config *const conf)
 {
 
 	// Reset the children
-	for (int i = conf->subpopulationSize; i < conf->familySize; ++i)
+	const Subpopulation children = subpop.from(conf->subpopulationSize);
+	const int nChildrenMax = conf->familySize - conf->subpopulationSize;
+	memset(children.chromosomes, 0, (size_t)nChildrenMax * conf->nWords * sizeof(uint64_t));
+	for (int i = 0; i < nChildrenMax; ++i)
 	{
-		memset(subpop[i].chromosome, 0, conf->nFeatures * sizeof(unsigned char));
 		for (unsigned char obj = 0; obj < conf->nObjectives; ++obj)
 		{
-			subpop[i].fitness[obj] = 0.0f;
+			children.fitness[obj][i] = 0.0f;
 		}
-		subpop[i].nSelFeatures = 0;
-		subpop[i].rank = -1;
-		subpop[i].crowding = 0.0f;
+		children.nSelFeatures[i] = 0;
+		children.rank[i] = -1;
+		children.crowding[i] = 0.0f;
 	}
 
-	Individual *child = &(subpop[conf->subpopulationSize]);
+	int nChildren = 0;
 	for (int i = 0; i < conf->poolSize; ++i)
 	{
+		uint64_t *const child = children.chromosome(nChildren);
 
 		// 75% probability perform crossover. Two childen are generated
-		Individual *parent1 = &(subpop[pool[rand() % conf->poolSize]]);
-		if ((rand() / (float)RAND_MAX) < 0.75f)
+		int parent1 = pool[rng->nextInt(conf->poolSize)];
+		const uint64_t *const chromosome1 = subpop.chromosome(parent1);
+		if (rng->nextFloat() < 0.75f)
 		{
 
 			// Avoid repeated parents
-			Individual *parent2 = &(subpop[pool[rand() % conf->poolSize]]);
-			Individual *child2 = child + 1;
+			int parent2 = pool[rng->nextInt(conf->poolSize)];
+			uint64_t *const child2 = children.chromosome(nChildren + 1);
 			while (parent1 == parent2)
 			{
-				parent2 = &(subpop[pool[rand() % conf->poolSize]]);
+				parent2 = pool[rng->nextInt(conf->poolSize)];
 			}
+			const uint64_t *const chromosome2 = subpop.chromosome(parent2);
 
-			// Perform uniform crossover for each decision variable in the chromosome
-			for (int f = 0; f < conf->nFeatures; ++f)
+			// Perform uniform crossover word by word. Each bit of the random mask selects the parent of the decision variable (50% probability)
+			for (int w = 0; w < conf->nWords; ++w)
 			{
-
-				// 50% probability perform copy the decision variable of the other parent
-				if ((parent1->chromosome[f] != parent2->chromosome[f]) && ((rand() / (float)RAND_MAX) < 0.5f))
-				{
-					child->nSelFeatures += (child->chromosome[f] = parent2->chromosome[f]);
-					child2->nSelFeatures += (child2->chromosome[f] = parent1->chromosome[f]);
-				}
-				else
-				{
-					child->nSelFeatures += (child->chromosome[f] = parent1->chromosome[f]);
-					child2->nSelFeatures += (child2->chromosome[f] = parent2->chromosome[f]);
-				}
+				uint64_t swapMask = rng->next();
+				child[w] = (chromosome1[w] & ~swapMask) | (chromosome2[w] & swapMask);
+				child2[w] = (chromosome2[w] & ~swapMask) | (chromosome1[w] & swapMask);
 			}
+			children.nSelFeatures[nChildren] = countSelected(child, conf->nWords);
+			children.nSelFeatures[nChildren + 1] = countSelected(child2, conf->nWords);
 
 			// At least one decision variable must be set to '1'
-			if (child->nSelFeatures == 0)
+			if (children.nSelFeatures[nChildren] == 0)
 			{
-				child->chromosome[rand() % conf->nFeatures] = child->nSelFeatures = 1;
+				selectFeature(child, rng->nextInt(conf->nFeatures));
+				children.nSelFeatures[nChildren] = 1;
 			}
 
-			if (child2->nSelFeatures == 0)
+			if (children.nSelFeatures[nChildren + 1] == 0)
 			{
-				child2->chromosome[rand() % conf->nFeatures] = child2->nSelFeatures = 1;
+				selectFeature(child2, rng->nextInt(conf->nFeatures));
+				children.nSelFeatures[nChildren + 1] = 1;
 			}
-			child += 2;
+			nChildren += 2;
 		}
 
 		// 25% probability perform mutation. One child is generated
@@ -205,39 +252,33 @@ int crossoverUniform(Individual *const subpop, const int *const pool, const Conf
 		else
 		{
 
-			// Perform mutation on each element of the selected parent
-			for (int f = 0; f < conf->nFeatures; ++f)
+			// 10% probability perform mutation (gen level). Instead of a draw per gen, the genes between two mutations are skipped
+			memcpy(child, chromosome1, conf->nWords * sizeof(uint64_t));
+			const double logNoMutation = log(1.0 - 0.1);
+			for (int f = rng->nextGeometric(logNoMutation); f < conf->nFeatures; f += 1 + rng->nextGeometric(logNoMutation))
 			{
-
-				// 10% probability perform mutation (gen level)
-				float probability = (rand() / (float)RAND_MAX);
-				if (probability < 0.1f)
+				if (rng->nextFloat() > 0.01f)
 				{
-					if ((rand() / (float)RAND_MAX) > 0.01f)
-					{
-						child->chromosome[f] = 0;
-					}
-					else
-					{
-						child->nSelFeatures += (child->chromosome[f] = 1);
-					}
+					child[f >> 6] &= ~((uint64_t)1 << (f & 63));
 				}
 				else
 				{
-					child->nSelFeatures += (child->chromosome[f] = parent1->chromosome[f]);
+					selectFeature(child, f);
 				}
 			}
+			children.nSelFeatures[nChildren] = countSelected(child, conf->nWords);
 
 			// At least one decision variable must be set to '1'
-			if (child->nSelFeatures == 0)
+			if (children.nSelFeatures[nChildren] == 0)
 			{
-				child->chromosome[rand() % conf->nFeatures] = child->nSelFeatures = 1;
+				selectFeature(child, rng->nextInt(conf->nFeatures));
+				children.nSelFeatures[nChildren] = 1;
 			}
-			++child;
+			++nChildren;
 		}
 	}
 
-	return child - (subpop + conf->subpopulationSize);
+	return nChildren;
 }
 
 /**
@@ -245,9 +286,12 @@ int crossoverUniform(Individual *const subpop, const int *const pool, const Conf
  * @param subpops The subpopulations
  * @param nSubpopulations The number of subpopulations involved in the migration
  * @param nIndsFronts0 The number of individuals in the front 0 of each subpopulation
+ * @param rng The random generator of the migration
+ * @param arenas The scratch arenas of the threads which sort the subpopulations
+ * @param nArenas The number of scratch arenas
  * @param conf The structure with all configuration parameters
  */
-void migration(Individual *const subpops, const int nSubpopulations, const int *const nIndsFronts0, const Config *const conf)
+void migration(const Subpopulation subpops, const int nSubpopulations, const int *const nIndsFronts0, RandomGenerator *const rng, ScratchArena *const *const arenas, const int nArenas, const Config *const conf)
 {
 
 	// From subpopulations randomly choosen some individuals of the front 0 are copied to each subpopulation (the worst individuals are deleted)
@@ -260,21 +304,23 @@ void migration(Individual *const subpops, const int nSubpopulations, const int *
 
 		// The current subpopulation will not copy its own individuals
 		randomIndex.erase(randomIndex.begin() + subpop);
-		std::random_shuffle(randomIndex.begin(), randomIndex.end());
+		for (int i = (int)randomIndex.size() - 1; i > 0; --i)
+		{
+			std::swap(randomIndex[i], randomIndex[rng->nextInt(i + 1)]);
+		}
 
 		int maxCopy = conf->subpopulationSize - nIndsFronts0[subpop];
-		Individual *ptrDest = subpops + (subpop * conf->familySize) + conf->subpopulationSize;
+		int dest = (subpop * conf->familySize) + conf->subpopulationSize;
 		for (int subpop2 = 0; subpop2 < nSubpopulations - 1 && maxCopy > 0; ++subpop2)
 		{
 			int toCopy = std::min(maxCopy, nIndsFronts0[randomIndex[subpop2]] >> 1);
-			Individual *ptrOrig = subpops + (randomIndex[subpop2] * conf->familySize);
-			ptrDest -= toCopy;
-			memcpy(ptrDest, ptrOrig, toCopy * sizeof(Individual));
+			dest -= toCopy;
+			copyIndividuals(subpops.from(dest), subpops.from(randomIndex[subpop2] * conf->familySize), toCopy);
 			maxCopy -= toCopy;
 		}
 	}
 
-#pragma omp parallel for
+#pragma omp parallel for num_threads(nArenas)
 	for (int sp = 0; sp < nSubpopulations; ++sp)
 	{
 		int popIndex = sp * conf->familySize;
@@ -282,9 +328,9 @@ void migration(Individual *const subpops, const int nSubpopulations, const int *
 		// The crowding distance of the subpopulation is initialized again for the next nonDominationSort
 		for (int i = popIndex; i < popIndex + conf->subpopulationSize; ++i)
 		{
-			subpops[i].crowding = 0.0f;
+			subpops.crowding[i] = 0.0f;
 		}
-		nonDominationSort(subpops + popIndex, conf->subpopulationSize, conf);
+		nonDominationSort(subpops.from(popIndex), conf->subpopulationSize, arenas[omp_get_thread_num()], conf);
 	}
 }
 
@@ -295,10 +341,13 @@ void migration(Individual *const subpops, const int nSubpopulations, const int *
  * @param devicesObject Structure containing the information of a device
  * @param trDataBase The training database which will contain the instances and the features
  * @param selInstances The instances choosen as initial centroids
+ * @param fitnessCache The cache with the raw fitness of the already evaluated chromosomes (NULL if disabled)
+ * @param rng The random generator of the island for this epoch
+ * @param arena The scratch arena where the temporaries of the generations are stored
  * @param conf The structure with all configuration parameters
  * @param initialize If the subpopulation must be initialized or not
  */
-void evolve(Individual *const subpop, int *const nIndsFronts0, CLDevice *const devicesObject, const float *const trDataBase, const int *const selInstances, const Config *const conf, const bool initialize)
+void evolve(const Subpopulation subpop, int *const nIndsFronts0, CLDevice *const devicesObject, const float *const trDataBase, const int *const selInstances, FitnessCache *const fitnessCache, RandomGenerator *const rng, ScratchArena *const arena, const Config *const conf, const bool initialize)
 {
 #if LOG_ENABLED
 	std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Starting evolution" << std::endl;
@@ -310,69 +359,419 @@ void evolve(Individual *const subpop, int *const nIndsFronts0, CLDevice *const d
 #if LOG_ENABLED
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Initial evaluation" << std::endl;
 #endif
-		evaluation(subpop, conf->subpopulationSize, devicesObject, nDevices, trDataBase, selInstances, conf);
+		evaluation(subpop, conf->subpopulationSize, devicesObject, nDevices, trDataBase, selInstances, fitnessCache, arena, conf);
 
 #if LOG_ENABLED
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Performing nonDominationSort (initial)" << std::endl;
 #endif
-		nIndsFronts0[0] = nonDominationSort(subpop, conf->subpopulationSize, conf);
+		nIndsFronts0[0] = nonDominationSort(subpop, conf->subpopulationSize, arena, conf);
 	}
 
+#if ALLOCATION_COUNTER_ENABLED
+	long int steadyAllocations = 0;
+#endif
 	for (int g = 0; g < conf->nGenerations; ++g)
 	{
+#if ALLOCATION_COUNTER_ENABLED
+		long int allocations = getHeapAllocations();
+#endif
 #if LOG_ENABLED
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Generation " << g << std::endl;
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Getting pool and performing crossover" << std::endl;
 #endif
-		const int *const pool = getPool(conf);
-		int nChildren = crossoverUniform(subpop, pool, conf);
+		const size_t mark = arena->mark();
+		const int *const pool = getPool(rng, arena, conf);
+		int nChildren = crossoverUniform(subpop, pool, rng, conf);
 
-		delete[] pool;
+		arena->release(mark);
 
 #if LOG_ENABLED
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Evaluating children" << std::endl;
 #endif
-		evaluation(subpop + conf->subpopulationSize, nChildren, devicesObject, nDevices, trDataBase, selInstances, conf);
+		evaluation(subpop.from(conf->subpopulationSize), nChildren, devicesObject, nDevices, trDataBase, selInstances, fitnessCache, arena, conf);
 
 #if LOG_ENABLED
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Resetting crowding distance" << std::endl;
 #endif
 		for (int i = 0; i < conf->subpopulationSize; ++i)
 		{
-			subpop[i].crowding = 0.0f;
+			subpop.crowding[i] = 0.0f;
 		}
 
 #if LOG_ENABLED
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Performing nonDominationSort (replacement)" << std::endl;
 #endif
-		nIndsFronts0[0] = nonDominationSort(subpop, conf->subpopulationSize + nChildren, conf);
+		nIndsFronts0[0] = nonDominationSort(subpop, conf->subpopulationSize + nChildren, arena, conf);
+
+		// The first generation is left out, since it may initialize the lazy globals of the process
+#if ALLOCATION_COUNTER_ENABLED
+		if (g > 0)
+		{
+			steadyAllocations += getHeapAllocations() - allocations;
+		}
+#endif
 	}
+#if ALLOCATION_COUNTER_ENABLED
+	std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: " << steadyAllocations << " heap allocations in "
+			  << std::max(0, conf->nGenerations - 1) << " steady-state generations (all threads are counted)" << std::endl;
+#endif
 
 #if LOG_ENABLED
 	std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Evolution finished" << std::endl;
 #endif
 }
 
+/**
+ * @brief Gets the islands which receive the emigrants of an island in the asynchronous island model
+ * @param island The island (subpopulation) index
+ * @param epoch The global migration index
+ * @param neighbours Where the indexes of the neighbours are stored (2 at most)
+ * @param conf The structure with all configuration parameters
+ * @return The number of neighbours
+ */
+static int getNeighbours(const int island, const int epoch, int *const neighbours, const Config *const conf)
+{
+
+	int n = conf->nSubpopulations;
+	if (n < 2)
+	{
+		return 0;
+	}
+
+	int nNeighbours = 0;
+	if (conf->topology == TOPOLOGY_RING)
+	{
+		neighbours[nNeighbours++] = (island + 1) % n;
+	}
+
+	// The islands are placed in the most square grid possible. The emigrants go to the east and to the south
+	else if (conf->topology == TOPOLOGY_TORUS)
+	{
+		int cols = (int)sqrt((double)n);
+		while (n % cols != 0)
+		{
+			--cols;
+		}
+		int rows = n / cols;
+		int row = island / cols;
+		int col = island % cols;
+		int east = (row * cols) + ((col + 1) % cols);
+		int south = (((row + 1) % rows) * cols) + col;
+		if (east != island)
+		{
+			neighbours[nNeighbours++] = east;
+		}
+		if (south != island && south != east)
+		{
+			neighbours[nNeighbours++] = south;
+		}
+	}
+
+	// A different island is randomly choosen in each epoch
+	else
+	{
+		RandomGenerator rng(conf->seed, RNG_MIGRATION, island, epoch);
+		int other = rng.nextInt(n - 1);
+		neighbours[nNeighbours++] = other + (other >= island);
+	}
+
+	return nNeighbours;
+}
+
+/**
+ * @brief Counts the groups of immigrants that an island receives during the whole asynchronous run
+ * @param island The island (subpopulation) index
+ * @param conf The structure with all configuration parameters
+ * @return The number of messages with immigrants
+ */
+static int countImmigrations(const int island, const Config *const conf)
+{
+
+	int nImmigrations = 0;
+	for (int epoch = 0; epoch < conf->nGlobalMigrations - 1; ++epoch)
+	{
+		for (int sp = 0; sp < conf->nSubpopulations; ++sp)
+		{
+			int neighbours[2];
+			int nNeighbours = getNeighbours(sp, epoch, neighbours, conf);
+			for (int n = 0; n < nNeighbours; ++n)
+			{
+				nImmigrations += (neighbours[n] == island);
+			}
+		}
+	}
+
+	return nImmigrations;
+}
+
+/**
+ * @brief Assigns consecutive islands to each worker in proportion to its capacity (number of devices)
+ * @param capacities The capacity of each MPI process. The master does not evolve any island
+ * @param firstIsland The first island of each MPI process. The position 'mpiSize' contains the number of islands
+ * @param conf The structure with all configuration parameters
+ */
+static void assignIslands(const int *const capacities, int *const firstIsland, const Config *const conf)
+{
+
+	// Each island goes to the worker which would be the least loaded after receiving it
+	std::vector<int> nIslands(conf->mpiSize, 0);
+	for (int sp = 0; sp < conf->nSubpopulations; ++sp)
+	{
+		int best = 1;
+		for (int p = 2; p < conf->mpiSize; ++p)
+		{
+			if ((nIslands[p] + 1) * std::max(1, capacities[best]) < (nIslands[best] + 1) * std::max(1, capacities[p]))
+			{
+				best = p;
+			}
+		}
+		++nIslands[best];
+	}
+
+	firstIsland[0] = 0;
+	for (int p = 0; p < conf->mpiSize; ++p)
+	{
+		firstIsland[p + 1] = firstIsland[p] + nIslands[p];
+	}
+}
+
+/**
+ * @brief Gets the MPI process which evolves an island
+ * @param island The island (subpopulation) index
+ * @param firstIsland The first island of each MPI process
+ * @return The MPI rank
+ */
+static int getOwner(const int island, const int *const firstIsland)
+{
+
+	int p = 1;
+	while (island >= firstIsland[p + 1])
+	{
+		++p;
+	}
+	return p;
+}
+
+/**
+ * @brief Replaces the worst individuals of a subpopulation by immigrants. The individuals in the front 0 are never replaced
+ * @param subpop The subpopulation, already sorted
+ * @param nIndsFront0 The number of individuals in the front 0 of the subpopulation
+ * @param immigrants The immigrants
+ * @param nImmigrants The number of immigrants
+ * @param arena The scratch arena of the thread
+ * @param conf The structure with all configuration parameters
+ */
+static void integrateImmigrants(const Subpopulation subpop, int *const nIndsFront0, const Individual *const immigrants, const int nImmigrants, ScratchArena *const arena, const Config *const conf)
+{
+
+	int toCopy = std::min(nImmigrants, conf->subpopulationSize - *nIndsFront0);
+	if (toCopy <= 0)
+	{
+		return;
+	}
+
+	unpackIndividuals(immigrants, toCopy, subpop.from(conf->subpopulationSize - toCopy), conf);
+	for (int i = 0; i < conf->subpopulationSize; ++i)
+	{
+		subpop.crowding[i] = 0.0f;
+	}
+	*nIndsFront0 = nonDominationSort(subpop, conf->subpopulationSize, arena, conf);
+}
+
+/**
+ * @brief Receives the immigrants sent to an island and integrates them into its subpopulation
+ * @param subpop The subpopulation of the island
+ * @param nIndsFront0 The number of individuals in the front 0 of the subpopulation
+ * @param nPending The number of messages with immigrants not received yet
+ * @param island The island (subpopulation) index. It is also the tag of the messages
+ * @param wait If all pending messages must be waited for or only the already arrived ones are received
+ * @param arena The scratch arena of the thread
+ * @param Individual_MPI_type The MPI datatype of an individual
+ * @param conf The structure with all configuration parameters
+ */
+static void receiveImmigrants(const Subpopulation subpop, int *const nIndsFront0, int *const nPending, const int island, const bool wait, ScratchArena *const arena, const MPI::Datatype &Individual_MPI_type, const Config *const conf)
+{
+
+	// The buffer is allocated as words, since the size of the individuals is only known at runtime
+	MPI::Status status;
+	std::vector<uint64_t> immigrants;
+	while (*nPending > 0)
+	{
+		if (wait)
+		{
+			MPI::COMM_WORLD.Probe(MPI::ANY_SOURCE, island, status);
+		}
+		else if (!MPI::COMM_WORLD.Iprobe(MPI::ANY_SOURCE, island, status))
+		{
+			break;
+		}
+
+		int nImmigrants = status.Get_count(Individual_MPI_type);
+		immigrants.resize(std::max(1, nImmigrants) * (conf->individualSize / sizeof(uint64_t)));
+		MPI::COMM_WORLD.Recv(immigrants.data(), nImmigrants, Individual_MPI_type, status.Get_source(), island);
+		integrateImmigrants(subpop, nIndsFront0, (const Individual *)immigrants.data(), nImmigrants, arena, conf);
+		--(*nPending);
+	}
+}
+
+/**
+ * @brief Evolves the islands of a worker in the asynchronous island model
+ *
+ * Each thread evolves its islands epoch after epoch without waiting for the rest of islands. After each epoch, half of
+ * the front 0 of an island is sent to its neighbours with non-blocking messages, and the immigrants which have already
+ * arrived are integrated. The pending immigrants are waited for at the end, before sending the subpopulation to the master
+ * @param subpops The subpopulations of the worker
+ * @param firstIsland The first island of each MPI process
+ * @param devicesObject Structure containing the information of a device
+ * @param trDataBase The training database which will contain the instances and the features
+ * @param selInstances The instances choosen as initial centroids
+ * @param fitnessCache The cache with the raw fitness of the already evaluated chromosomes (NULL if disabled)
+ * @param Individual_MPI_type The MPI datatype of an individual
+ * @param conf The structure with all configuration parameters
+ */
+static void evolveAsync(const Subpopulation subpops, const int *const firstIsland, CLDevice *const devicesObject, const float *const trDataBase, const int *const selInstances, FitnessCache *const fitnessCache, const MPI::Datatype &Individual_MPI_type, const Config *const conf)
+{
+
+	int first = firstIsland[conf->mpiRank];
+	int nIslands = firstIsland[conf->mpiRank + 1] - first;
+	int nThreads = std::max(1, std::min(conf->nDevices, nIslands));
+	std::vector<int> nIndsFronts0(nIslands);
+	std::vector<int> nPending(nIslands);
+	for (int l = 0; l < nIslands; ++l)
+	{
+		nPending[l] = countImmigrations(first + l, conf);
+	}
+
+#pragma omp parallel num_threads(nThreads)
+	{
+		int threadID = omp_get_thread_num();
+
+		// The emigrants are packed into their own records, since the subpopulation keeps evolving while they are sent
+		std::list<std::vector<uint64_t>> emigrants;
+		std::vector<MPI::Request> requests;
+		Individual *records = createIndividuals(conf->familySize, conf);
+		ScratchArena arena(conf->familySize, conf->ompThreads, conf);
+		for (int epoch = 0; epoch < conf->nGlobalMigrations; ++epoch)
+		{
+			for (int l = threadID; l < nIslands; l += nThreads)
+			{
+				int island = first + l;
+				Subpopulation subpop = subpops.from(l * conf->familySize);
+				if (epoch > 0)
+				{
+					receiveImmigrants(subpop, &nIndsFronts0[l], &nPending[l], island, false, &arena, Individual_MPI_type, conf);
+				}
+
+#if LOG_ENABLED
+				std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Worker thread " << threadID << " evolving subpopulation " << island << " (epoch " << epoch << ")" << std::endl;
+#endif
+				RandomGenerator rng(conf->seed, RNG_EVOLUTION, island, epoch);
+				evolve(subpop, &nIndsFronts0[l], &devicesObject[threadID], trDataBase, selInstances, fitnessCache, &rng, &arena, conf, epoch == 0);
+
+				if (epoch != conf->nGlobalMigrations - 1)
+				{
+					int neighbours[2];
+					int nNeighbours = getNeighbours(island, epoch, neighbours, conf);
+					int nEmigrants = std::min(conf->subpopulationSize, nIndsFronts0[l]) >> 1;
+					for (int n = 0; n < nNeighbours; ++n)
+					{
+						emigrants.push_back(std::vector<uint64_t>(std::max(1, nEmigrants) * (conf->individualSize / sizeof(uint64_t))));
+						packIndividuals(subpop, nEmigrants, (Individual *)emigrants.back().data(), conf);
+						requests.push_back(MPI::COMM_WORLD.Isend(emigrants.back().data(), nEmigrants, Individual_MPI_type, getOwner(neighbours[n], firstIsland), neighbours[n]));
+					}
+				}
+			}
+		}
+
+		// All emigrants have already been sent, so the pending immigrants will arrive
+		for (int l = threadID; l < nIslands; l += nThreads)
+		{
+			int island = first + l;
+			Subpopulation subpop = subpops.from(l * conf->familySize);
+			receiveImmigrants(subpop, &nIndsFronts0[l], &nPending[l], island, true, &arena, Individual_MPI_type, conf);
+			packIndividuals(subpop, conf->familySize, records, conf);
+			MPI::COMM_WORLD.Send(records, conf->familySize, Individual_MPI_type, 0, island);
+		}
+		MPI::Request::Waitall((int)requests.size(), requests.data());
+		deleteIndividuals(records);
+	}
+}
+
+/**
+ * @brief Allocates the scratch arenas of the threads which evolve islands at the same time
+ * @param nArenas The number of threads
+ * @param conf The structure with all configuration parameters
+ * @return The arenas, one per thread
+ */
+static ScratchArena **createArenas(const int nArenas, const Config *const conf)
+{
+
+	ScratchArena **arenas = new ScratchArena *[nArenas];
+	for (int i = 0; i < nArenas; ++i)
+	{
+		arenas[i] = new ScratchArena(conf->familySize, conf->ompThreads, conf);
+	}
+
+	return arenas;
+}
+
+/**
+ * @brief Releases the scratch arenas allocated with 'createArenas'
+ * @param arenas The arenas
+ * @param nArenas The number of arenas
+ */
+static void deleteArenas(ScratchArena **const arenas, const int nArenas)
+{
+
+	for (int i = 0; i < nArenas; ++i)
+	{
+		delete arenas[i];
+	}
+	delete[] arenas;
+}
+
+/**
+ * @brief Receives the subpopulation of an island evolved by a worker and stores it in its own position
+ * @param subpops The subpopulations
+ * @param records The buffer of records of all subpopulations
+ * @param island The island (subpopulation) index. It is also the tag of the message
+ * @param source The MPI process which sends the subpopulation
+ * @param Individual_MPI_type The MPI datatype of an individual
+ * @param status Where the status of the reception is stored
+ * @param conf The structure with all configuration parameters
+ */
+static void receiveIsland(const Subpopulation subpops, Individual *const records, const int island, const int source, const MPI::Datatype &Individual_MPI_type, MPI::Status *const status, const Config *const conf)
+{
+
+	int popIndex = island * conf->familySize;
+	MPI::COMM_WORLD.Recv(getIndividual(records, popIndex, conf), conf->familySize, Individual_MPI_type, source, island, *status);
+	unpackIndividuals(getIndividual(records, popIndex, conf), conf->familySize, subpops.from(popIndex), conf);
+}
+
 /**
  * @brief Island-based genetic algorithm model
- * @param subpops The initial subpopulations
+ * @param population The initial subpopulations (only in the master)
  * @param devicesObject Structure containing the information of a device
  * @param trDataBase The training database which will contain the instances and the features
  * @param selInstances The instances choosen as initial centroids
+ * @param fitnessCache The cache with the raw fitness of the already evaluated chromosomes (NULL if disabled)
  * @param conf The structure with all configuration parameters
  */
-void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *const trDataBase, const int *const selInstances, const Config *const conf)
+void agIslands(Population *const population, CLDevice *const devicesObject, const float *const trDataBase, const int *const selInstances, FitnessCache *const fitnessCache, const Config *const conf)
 {
 #if LOG_ENABLED
 	std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Entered agIslands" << std::endl;
 #endif
 
+	// The extent of the datatype is the size of an individual, since the chromosome follows the fields of the structure
 	MPI::Status status;
-	int array_of_blocklengths[3] = {conf->nFeatures, conf->nObjectives + 1, 2};
-	MPI::Datatype array_of_types[3] = {MPI::UNSIGNED_CHAR, MPI::FLOAT, MPI::INT};
-	MPI::Aint array_of_displacement[3] = {offsetof(Individual, chromosome), offsetof(Individual, fitness), offsetof(Individual, rank)};
-	MPI::Datatype Individual_MPI_type = MPI::Datatype::Create_struct(3, array_of_blocklengths, array_of_displacement, array_of_types);
+	int array_of_blocklengths[3] = {conf->nObjectives + 1, 2, conf->nWords};
+	MPI::Datatype array_of_types[3] = {MPI::FLOAT, MPI::INT, MPI::UNSIGNED_LONG_LONG};
+	MPI::Aint array_of_displacement[3] = {offsetof(Individual, fitness), offsetof(Individual, rank), offsetof(Individual, chromosome)};
+	MPI::Datatype Individual_struct_type = MPI::Datatype::Create_struct(3, array_of_blocklengths, array_of_displacement, array_of_types);
+	MPI::Datatype Individual_MPI_type = Individual_struct_type.Create_resized(0, conf->individualSize);
 	Individual_MPI_type.Commit();
+	Individual_struct_type.Free();
 
 #if LOG_ENABLED
 	std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: MPI datatype for Individual committed" << std::endl;
@@ -390,6 +789,12 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Acting as master" << std::endl;
 #endif
 		double timeStart = omp_get_wtime();
+		Subpopulation subpops = population->view(0);
+		Individual *records = (conf->mpiSize > 1) ? createIndividuals(conf->totalIndividuals, conf) : NULL;
+
+		// One scratch arena for each thread which evolves or sorts islands at the same time
+		int nThreads = std::max(1, std::min(conf->nDevices, conf->nSubpopulations));
+		ScratchArena **arenas = createArenas(nThreads, conf);
 		MPI::Request requests[conf->mpiSize - 1];
 		int nIndsFronts0[conf->nSubpopulations];
 		int finalFront0;
@@ -401,7 +806,6 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 			std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Single process mode detected" << std::endl;
 #endif
 			omp_set_nested(1);
-			int nThreads = std::min(conf->nDevices, conf->nSubpopulations);
 #if LOG_ENABLED
 			std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Using " << nThreads << " threads for evolution" << std::endl;
 #endif
@@ -422,7 +826,8 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 							  << "][" << __func__ << "]: Evolving subpopulation "
 							  << sp << std::endl;
 #endif
-					evolve(subpops + popIndex, &nIndsFronts0[sp], &devicesObject[omp_get_thread_num()], trDataBase, selInstances, conf, gMig == 0);
+					RandomGenerator rng(conf->seed, RNG_EVOLUTION, sp, gMig);
+					evolve(subpops.from(popIndex), &nIndsFronts0[sp], &devicesObject[omp_get_thread_num()], trDataBase, selInstances, fitnessCache, &rng, arenas[omp_get_thread_num()], conf, gMig == 0);
 				}
 
 				if (gMig != conf->nGlobalMigrations - 1 && conf->nSubpopulations > 1)
@@ -430,16 +835,54 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 #if LOG_ENABLED
 					std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Migrating between subpopulations" << std::endl;
 #endif
-					migration(subpops, conf->nSubpopulations, nIndsFronts0, conf);
+					RandomGenerator migrationRng(conf->seed, RNG_MIGRATION, 0, gMig);
+					migration(subpops, conf->nSubpopulations, nIndsFronts0, &migrationRng, arenas, nThreads, conf);
 				}
 			}
 		}
+		// Asynchronous islands. The master only collects the final subpopulations, in the order they finish
+		else if (conf->islandModel == ISLANDS_ASYNC)
+		{
+			int capacity = 0;
+			int capacities[conf->mpiSize];
+			int firstIsland[conf->mpiSize + 1];
+			MPI::COMM_WORLD.Allgather(&capacity, 1, MPI::INT, capacities, 1, MPI::INT);
+			assignIslands(capacities, firstIsland, conf);
+			for (int p = 1; p < conf->mpiSize; ++p)
+			{
+#if LOG_ENABLED
+				std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Sending islands " << firstIsland[p] << "-" << firstIsland[p + 1] - 1 << " to worker " << p << std::endl;
+#endif
+				int popIndex = firstIsland[p] * conf->familySize;
+				int nIndividuals = (firstIsland[p + 1] - firstIsland[p]) * conf->familySize;
+				packIndividuals(subpops.from(popIndex), nIndividuals, getIndividual(records, popIndex, conf), conf);
+				requests[p - 1] = MPI::COMM_WORLD.Isend(getIndividual(records, popIndex, conf), nIndividuals, Individual_MPI_type, p, firstIsland[p]);
+			}
+			MPI::Request::Waitall(conf->mpiSize - 1, requests);
+
+			for (int nReceived = 0; nReceived < conf->nSubpopulations; ++nReceived)
+			{
+				MPI::COMM_WORLD.Probe(MPI::ANY_SOURCE, MPI::ANY_TAG, status);
+				int island = status.Get_tag();
+				receiveIsland(subpops, records, island, status.Get_source(), Individual_MPI_type, &status, conf);
+				nIndsFronts0[island] = countFront0(subpops.from(island * conf->familySize), conf);
+#if LOG_ENABLED
+				std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Subpopulation " << island << " finished by worker " << status.Get_source() << std::endl;
+#endif
+			}
+		}
 		// I need to distribute
 		else
 		{
 #if LOG_ENABLED
 			std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Distributing work to workers" << std::endl;
 #endif
+			// The island and the epoch travel in the tags
+			int *tagUB;
+			int flag;
+			MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &tagUB, &flag);
+			check(flag && encodeTag(FINISH, conf->nSubpopulations - 1, conf->nGlobalMigrations - 1, conf) > *tagUB, "%s\n", AG_ERROR_TAG_UB);
+
 			int workerCapacities[conf->mpiSize - 1];
 			for (int p = 1; p < conf->mpiSize; ++p)
 			{
@@ -460,7 +903,7 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 #endif
 				int nextWork = 0;
 				int sent = 0;
-				int mpiTag = (gMig == 0) ? INITIALIZE : IGNORE_VALUE;
+				int mode = (gMig == 0) ? INITIALIZE : IGNORE_VALUE;
 				for (int p = 1; p < conf->mpiSize && nextWork < conf->nSubpopulations; ++p)
 				{
 					int finallyWork = std::min(workerCapacities[p - 1], conf->nSubpopulations - nextWork);
@@ -468,7 +911,8 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 #if LOG_ENABLED
 					std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Sending work to worker " << p << std::endl;
 #endif
-					requests[p - 1] = MPI::COMM_WORLD.Isend(subpops + popIndex, finallyWork * conf->familySize, Individual_MPI_type, p, mpiTag);
+					packIndividuals(subpops.from(popIndex), finallyWork * conf->familySize, getIndividual(records, popIndex, conf), conf);
+					requests[p - 1] = MPI::COMM_WORLD.Isend(getIndividual(records, popIndex, conf), finallyWork * conf->familySize, Individual_MPI_type, p, encodeTag(mode, nextWork, gMig, conf));
 					nextWork += finallyWork;
 					++sent;
 				}
@@ -477,29 +921,35 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 				std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: All work sent to workers" << std::endl;
 #endif
 
-				int receivedPtr = 0;
+				// Each result comes back tagged with its island, so it is stored in its own position
+				int nReceived = 0;
 				while (nextWork < conf->nSubpopulations)
 				{
 #if LOG_ENABLED
 					std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Waiting for results from any worker" << std::endl;
 #endif
-					MPI::COMM_WORLD.Recv(subpops + (receivedPtr * conf->familySize), conf->familySize, Individual_MPI_type, MPI::ANY_SOURCE, MPI::ANY_TAG, status);
+					MPI::COMM_WORLD.Probe(MPI::ANY_SOURCE, MPI::ANY_TAG, status);
+					int island = status.Get_tag();
+					receiveIsland(subpops, records, island, status.Get_source(), Individual_MPI_type, &status, conf);
 					int popIndex = nextWork * conf->familySize;
-					MPI::COMM_WORLD.Send(subpops + popIndex, conf->familySize, Individual_MPI_type, status.Get_source(), mpiTag);
-					nIndsFronts0[receivedPtr] = status.Get_tag();
-					++receivedPtr;
+					packIndividuals(subpops.from(popIndex), conf->familySize, getIndividual(records, popIndex, conf), conf);
+					MPI::COMM_WORLD.Send(getIndividual(records, popIndex, conf), conf->familySize, Individual_MPI_type, status.Get_source(), encodeTag(mode, nextWork, gMig, conf));
+					nIndsFronts0[island] = countFront0(subpops.from(island * conf->familySize), conf);
+					++nReceived;
 					++nextWork;
 				}
 
-				while (receivedPtr < conf->nSubpopulations)
+				while (nReceived < conf->nSubpopulations)
 				{
 #if LOG_ENABLED
 					std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Receiving remaining results from workers" << std::endl;
 #endif
-					MPI::COMM_WORLD.Recv(subpops + (receivedPtr * conf->familySize), conf->familySize, Individual_MPI_type, MPI::ANY_SOURCE, MPI::ANY_TAG, status);
+					MPI::COMM_WORLD.Probe(MPI::ANY_SOURCE, MPI::ANY_TAG, status);
+					int island = status.Get_tag();
+					receiveIsland(subpops, records, island, status.Get_source(), Individual_MPI_type, &status, conf);
 					MPI::COMM_WORLD.Send(NULL, 0, MPI::INT, status.Get_source(), FINISH);
-					nIndsFronts0[receivedPtr] = status.Get_tag();
-					++receivedPtr;
+					nIndsFronts0[island] = countFront0(subpops.from(island * conf->familySize), conf);
+					++nReceived;
 				}
 
 				if (gMig != conf->nGlobalMigrations - 1 && conf->nSubpopulations > 1)
@@ -507,7 +957,8 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 #if LOG_ENABLED
 					std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Migrating between subpopulations" << std::endl;
 #endif
-					migration(subpops, conf->nSubpopulations, nIndsFronts0, conf);
+					RandomGenerator migrationRng(conf->seed, RNG_MIGRATION, 0, gMig);
+					migration(subpops, conf->nSubpopulations, nIndsFronts0, &migrationRng, arenas, nThreads, conf);
 				}
 			}
 
@@ -525,19 +976,17 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 #if LOG_ENABLED
 			std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Recombination process started" << std::endl;
 #endif
-			for (int sp = 0; sp < conf->nSubpopulations; ++sp)
+			// The parents of the first subpopulation are already in place
+			for (int sp = 1; sp < conf->nSubpopulations; ++sp)
 			{
 #if LOG_ENABLED
 				std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Copying subpopulation " << sp << std::endl;
 #endif
-				memcpy(subpops + (sp * conf->subpopulationSize), subpops + (sp * conf->familySize), conf->subpopulationSize * sizeof(Individual));
+				copyIndividuals(subpops.from(sp * conf->subpopulationSize), subpops.from(sp * conf->familySize), conf->subpopulationSize);
 			}
-#pragma omp parallel for
-			for (int i = 0; i < conf->worldSize; ++i)
-			{
-				subpops[i].crowding = 0.0f;
-			}
-			finalFront0 = std::min(conf->subpopulationSize, nonDominationSort(subpops, conf->worldSize, conf));
+			std::fill(subpops.crowding, subpops.crowding + conf->worldSize, 0.0f);
+			ScratchArena arena(conf->worldSize, 0, conf);
+			finalFront0 = std::min(conf->subpopulationSize, nonDominationSort(subpops, conf->worldSize, &arena, conf));
 #if LOG_ENABLED
 			std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: nonDominationSort completed" << std::endl;
 #endif
@@ -549,6 +998,8 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 
 		MPI::Request::Waitall(conf->mpiSize - 1, requests);
 		MPI::COMM_WORLD.Barrier();
+		deleteIndividuals(records);
+		deleteArenas(arenas, nThreads);
 
 #if LOG_ENABLED
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Generating data plot and gnuplot files" << std::endl;
@@ -565,44 +1016,78 @@ void agIslands(Individual *subpops, CLDevice *const devicesObject, const float *
 #if LOG_ENABLED
 		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Acting as worker" << std::endl;
 #endif
-		MPI::COMM_WORLD.Isend(&(conf->nDevices), 1, MPI::INT, 0, 0);
 		omp_set_nested(1);
-		subpops = new Individual[conf->nDevices * conf->familySize];
-
-		MPI::COMM_WORLD.Recv(subpops, conf->nDevices * conf->familySize, Individual_MPI_type, 0, MPI::ANY_TAG, status);
-
-		while (status.Get_tag() != FINISH)
+		if (conf->islandModel == ISLANDS_ASYNC)
+		{
+			int capacity = conf->nDevices;
+			int capacities[conf->mpiSize];
+			int firstIsland[conf->mpiSize + 1];
+			MPI::COMM_WORLD.Allgather(&capacity, 1, MPI::INT, capacities, 1, MPI::INT);
+			assignIslands(capacities, firstIsland, conf);
+
+			int nIslands = firstIsland[conf->mpiRank + 1] - firstIsland[conf->mpiRank];
+			Population islands(std::max(1, nIslands) * conf->familySize, conf);
+			Individual *records = createIndividuals(std::max(1, nIslands) * conf->familySize, conf);
+			MPI::COMM_WORLD.Recv(records, nIslands * conf->familySize, Individual_MPI_type, 0, MPI::ANY_TAG, status);
+			unpackIndividuals(records, nIslands * conf->familySize, islands.view(0), conf);
+			deleteIndividuals(records);
+			evolveAsync(islands.view(0), firstIsland, devicesObject, trDataBase, selInstances, fitnessCache, Individual_MPI_type, conf);
+		}
+		else
 		{
-			int nSubpopulations = status.Get_count(Individual_MPI_type) / conf->familySize;
-			int EXIT = false;
+			MPI::COMM_WORLD.Isend(&(conf->nDevices), 1, MPI::INT, 0, 0);
+			Population islands(conf->nDevices * conf->familySize, conf);
+			Subpopulation subpops = islands.view(0);
+			Individual *records = createIndividuals(conf->nDevices * conf->familySize, conf);
+			ScratchArena **arenas = createArenas(conf->nDevices, conf);
+			MPI::COMM_WORLD.Recv(records, conf->nDevices * conf->familySize, Individual_MPI_type, 0, MPI::ANY_TAG, status);
+
+			while (status.Get_tag() % N_MODES != FINISH)
+			{
+				int nSubpopulations = status.Get_count(Individual_MPI_type) / conf->familySize;
+				int EXIT = false;
+				unpackIndividuals(records, nSubpopulations * conf->familySize, subpops, conf);
 
 #if LOG_ENABLED
-			std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Worker received " << nSubpopulations << " subpopulations" << std::endl;
+				std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Worker received " << nSubpopulations << " subpopulations" << std::endl;
 #endif
 #pragma omp parallel num_threads(nSubpopulations)
-			{
-				int threadID = omp_get_thread_num();
-				MPI::Request request;
-				MPI::Status stat = status;
-				int nIndsFronts0;
-				int popIndex = threadID * conf->familySize;
-				do
 				{
+					int threadID = omp_get_thread_num();
+					MPI::Request request;
+					MPI::Status stat = status;
+					int nIndsFronts0;
+					int popIndex = threadID * conf->familySize;
+
+					// The first message contains consecutive islands
+					int island = (stat.Get_tag() / N_MODES) % conf->nSubpopulations + threadID;
+					do
+					{
 #if LOG_ENABLED
-					std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Worker thread " << threadID << " evolving subpopulation" << std::endl;
+						std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Worker thread " << threadID << " evolving subpopulation " << island << std::endl;
 #endif
-					evolve(subpops + popIndex, &nIndsFronts0, &devicesObject[threadID], trDataBase, selInstances, conf, stat.Get_tag() == INITIALIZE);
-
-					request = MPI::COMM_WORLD.Isend(subpops + popIndex, conf->familySize, Individual_MPI_type, 0, nIndsFronts0);
-					request.Wait();
-					MPI::COMM_WORLD.Recv(subpops + popIndex, conf->familySize, Individual_MPI_type, 0, MPI::ANY_TAG, stat);
-				} while (stat.Get_tag() != FINISH);
-			}
+						RandomGenerator rng(conf->seed, RNG_EVOLUTION, island, stat.Get_tag() / N_MODES / conf->nSubpopulations);
+						evolve(subpops.from(popIndex), &nIndsFronts0, &devicesObject[threadID], trDataBase, selInstances, fitnessCache, &rng, arenas[threadID], conf, stat.Get_tag() % N_MODES == INITIALIZE);
+
+						packIndividuals(subpops.from(popIndex), conf->familySize, getIndividual(records, popIndex, conf), conf);
+						request = MPI::COMM_WORLD.Isend(getIndividual(records, popIndex, conf), conf->familySize, Individual_MPI_type, 0, island);
+						request.Wait();
+						MPI::COMM_WORLD.Recv(getIndividual(records, popIndex, conf), conf->familySize, Individual_MPI_type, 0, MPI::ANY_TAG, stat);
+						if (stat.Get_tag() % N_MODES != FINISH)
+						{
+							unpackIndividuals(getIndividual(records, popIndex, conf), conf->familySize, subpops.from(popIndex), conf);
+						}
+						island = (stat.Get_tag() / N_MODES) % conf->nSubpopulations;
+					} while (stat.Get_tag() % N_MODES != FINISH);
+				}
 
-			MPI::COMM_WORLD.Recv(subpops, conf->nDevices * conf->familySize, Individual_MPI_type, 0, MPI::ANY_TAG, status);
+				MPI::COMM_WORLD.Recv(records, conf->nDevices * conf->familySize, Individual_MPI_type, 0, MPI::ANY_TAG, status);
 #if LOG_ENABLED
-			std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Worker waiting for next batch" << std::endl;
+				std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Worker waiting for next batch" << std::endl;
 #endif
+			}
+			deleteIndividuals(records);
+			deleteArenas(arenas, conf->nDevices);
 		}
 
 		MPI::COMM_WORLD.Barrier();
@@ -0,0 +1,152 @@
+/**
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE', which is part of Hpmoon repository.
+ *
+ * This work has been funded by:
+ *
+ * Spanish 'Ministerio de Economía y Competitividad' under grants number TIN2012-32039 and TIN2015-67020-P.\n
+ * Spanish 'Ministerio de Ciencia, Innovación y Universidades' under grant number PGC2018-098813-B-C31.\n
+ * European Regional Development Fund (ERDF).
+ *
+ * @file arena.cpp
+ * @author agent
+ * @date 17/10/2026
+ * @brief Implementation of the scratch arena and the debug counter of heap allocations
+ * @copyright Hpmoon (c) 2015 EFFICOMP
+ */
+
+/********************************* Includes *******************************/
+
+#include "arena.h"
+#include <new>			// std::bad_alloc
+#include <stdint.h>		// uint64_t
+#include <stdlib.h>		// posix_memalign, malloc, free
+#include <log_config.h> // ALLOCATION_COUNTER_ENABLED
+
+/********************************* Globals ********************************/
+
+#if ALLOCATION_COUNTER_ENABLED
+/**
+ * @brief Number of heap allocations (operator new) of the process
+ */
+static long int heapAllocations = 0;
+#endif
+
+/********************************* Methods ********************************/
+
+/**
+ * @brief Rounds a size up to a whole number of cache lines
+ * @param nBytes The size in bytes
+ * @return The rounded size
+ */
+static size_t padded(const size_t nBytes)
+{
+	return (nBytes + 63) & ~(size_t)63;
+}
+
+/**
+ * @brief The constructor with parameters. The arena is sized for the largest generation of the configuration
+ * @param nIndividuals The maximum number of individuals which will be sorted at once
+ * @param nThreads The maximum number of threads which will run K-means at once (0 if the CPU does not evaluate)
+ * @param conf The structure with all configuration parameters
+ * @return An empty arena
+ */
+ScratchArena::ScratchArena(const int nIndividuals, const int nThreads, const Config *const conf)
+{
+
+	size_t n = nIndividuals;
+
+	// Candidates of the tournaments (the first round is the pool)
+	this->capacity = padded((size_t)conf->tourSize * conf->poolSize * sizeof(int));
+
+	// Non-dominated sorting: fitness, crowding, ranks, indexes, fronts and the permutation of the chromosomes
+	this->capacity += padded(conf->nObjectives * n * sizeof(float)) + padded(n * sizeof(float));
+	this->capacity += 5 * padded(n * sizeof(int)) + padded((n + 1) * sizeof(int));
+	this->capacity += padded(n * conf->nWords * sizeof(uint64_t)) + padded(n * sizeof(int));
+
+	// Points of the hypervolume
+	this->capacity += padded(n * sizeof(double *)) + padded(n * conf->nObjectives * sizeof(double));
+
+	// K-means buffers of each thread, sized for an individual with all the features selected
+	size_t nThreadsK = nThreads;
+	size_t coordinates = (size_t)conf->K * conf->nFeatures;
+	this->capacity += 3 * padded(nThreadsK * coordinates * sizeof(float));
+	this->capacity += padded(nThreadsK * conf->trNInstances * conf->nFeatures * sizeof(float));
+	this->capacity += padded(nThreadsK * conf->trNInstances * conf->K * sizeof(double));
+	this->capacity += padded(nThreadsK * conf->K * conf->K * sizeof(double));
+
+	void *memory = NULL;
+	check(posix_memalign(&memory, 64, this->capacity) != 0, "%s\n", ARENA_ERROR_ALLOC);
+	this->memory = (char *)memory;
+	this->used = 0;
+}
+
+/**
+ * @brief The destructor
+ */
+ScratchArena::~ScratchArena()
+{
+
+	free(this->memory);
+}
+
+/**
+ * @brief Hands out a block of the arena, aligned to a cache line
+ * @param nBytes The size in bytes of the block
+ * @return The address of the block
+ */
+void *ScratchArena::allocate(const size_t nBytes)
+{
+
+	size_t size = padded(nBytes);
+	check(this->used + size > this->capacity, "%s\n", ARENA_ERROR_FULL);
+	void *block = this->memory + this->used;
+	this->used += size;
+	return block;
+}
+
+/**
+ * @brief Gets the number of heap allocations (operator new) of the process so far. The counter is only kept if 'ALLOCATION_COUNTER_ENABLED' is set
+ * @return The number of allocations of all threads, or 0 if the counter is disabled
+ */
+long int getHeapAllocations()
+{
+#if ALLOCATION_COUNTER_ENABLED
+	long int allocations;
+#pragma omp atomic read
+	allocations = heapAllocations;
+	return allocations;
+#else
+	return 0;
+#endif
+}
+
+#if ALLOCATION_COUNTER_ENABLED
+/**
+ * @brief Replacement of the global allocation function which counts the allocations
+ * @param nBytes The size in bytes of the allocation
+ * @return The address of the allocated memory
+ */
+void *operator new(size_t nBytes)
+{
+
+#pragma omp atomic
+	++heapAllocations;
+	void *memory = malloc((nBytes > 0) ? nBytes : 1);
+	if (memory == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+/**
+ * @brief Replacement of the global deallocation function
+ * @param memory The address of the memory to be released
+ */
+void operator delete(void *memory) noexcept
+{
+
+	free(memory);
+}
+#endif
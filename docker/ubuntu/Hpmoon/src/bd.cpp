@@ -18,8 +18,19 @@
 /********************************* Includes *******************************/
 
 #include "bd.h"
-#include <cmath>   // exp, sqrt...
-#include <sstream> // stringstream
+#include <algorithm> // std::max, std::min
+#include <cmath>	 // exp, sqrt...
+#include <fcntl.h>	 // open
+#include <mpi.h>	 // MPI_Bcast, MPI_Win_allocate_shared...
+#include <omp.h>	 // omp_get_max_threads
+#include <sstream>	 // stringstream
+#include <stdio.h>	 // fopen, fread, rename...
+#include <stdlib.h>	 // strtof
+#include <string.h>	 // memcmp, memchr...
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // stat
+#include <unistd.h>	 // read, close, getpid
+#include <vector>	 // std::vector
 
 /********************************* Methods ********************************/
 
@@ -68,8 +79,439 @@ void normDataBase(float *const dataBase, const Config *const conf)
 	}
 }
 
+/**
+ * @brief Address and length of the memory-mapped database file, if any
+ */
+static void *mappedFile = NULL;
+static size_t mappedLength = 0;
+
+/**
+ * @brief MPI window with the database shared by the processes of the node, if any
+ */
+static MPI_Win sharedWindow = MPI_WIN_NULL;
+
+/**
+ * @brief Checks if a file starts with the signature of the binary format
+ * @param fileName The name of the file
+ * @return true if the file is a binary database
+ */
+static bool isBinaryDataBase(const char *const fileName)
+{
+
+	char magic[8];
+	FILE *f = fopen(fileName, "rb");
+	bool binary = (f != NULL && fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, BD_BINARY_MAGIC, sizeof(magic)) == 0);
+	if (f != NULL)
+	{
+		fclose(f);
+	}
+	return binary;
+}
+
+/**
+ * @brief Checks if the binary cache of a text database exists and is not older than it
+ * @param fileName The name of the text database
+ * @param cacheFileName The name of the binary cache
+ * @return true if the cache can be used
+ */
+static bool isCacheUpToDate(const char *const fileName, const char *const cacheFileName)
+{
+
+	struct stat textStat, cacheStat;
+	return stat(fileName, &textStat) == 0 && stat(cacheFileName, &cacheStat) == 0 && cacheStat.st_mtime >= textStat.st_mtime;
+}
+
+/**
+ * @brief Memory-maps a binary database. The mapping is private, so the values can be modified (e.g. normalized) without changing the file
+ * @param fileName The name of the binary file
+ * @param header Where the header of the database is stored
+ * @return The instances of the database or NULL if the file is not a valid binary database
+ */
+static float *mapBinaryDataBase(const char *const fileName, BinaryDataBaseHeader *const header)
+{
+
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	// The header must be supported and the file must contain exactly the block of floats
+	struct stat fileStat;
+	bool valid = fstat(fd, &fileStat) == 0 && read(fd, header, sizeof(BinaryDataBaseHeader)) == sizeof(BinaryDataBaseHeader) &&
+				 memcmp(header->magic, BD_BINARY_MAGIC, sizeof(header->magic)) == 0 && header->version == BD_BINARY_VERSION && header->dtype == BD_DTYPE_FLOAT32 &&
+				 (size_t)fileStat.st_size == sizeof(BinaryDataBaseHeader) + (size_t)header->nRows * header->nCols * sizeof(float);
+	void *file = (valid) ? mmap(NULL, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (file == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	mappedFile = file;
+	mappedLength = fileStat.st_size;
+	return (float *)((char *)file + sizeof(BinaryDataBaseHeader));
+}
+
+/**
+ * @brief Powers of 10 which are exactly representable as float
+ */
+static const float powersOf10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+/**
+ * @brief Checks if a character separates the values of a row
+ * @param c The character
+ * @return true if it is a blank character
+ */
+static inline bool isBlank(const char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * @brief Parses a float without depending on the locale (in the style of 'std::from_chars')
+ *
+ * A decimal mantissa up to 2^24 and an exponent up to 10 in absolute value are both exact in float, so the value is
+ * obtained with a single correctly rounded multiplication or division. The rest of values fall back to 'strtof'
+ * @param first The first character of the value
+ * @param last The character following the value
+ * @param value Where the value is stored
+ * @return true if the whole token is a valid value
+ */
+static bool parseFloat(const char *const first, const char *const last, float *const value)
+{
+
+	const char *p = first;
+	bool negative = (*p == '-');
+	if (*p == '-' || *p == '+')
+	{
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	int nDigits = 0;
+	int exponent = 0;
+	for (; p < last && *p >= '0' && *p <= '9'; ++p, ++nDigits)
+	{
+		mantissa = (mantissa * 10) + (*p - '0');
+	}
+	if (p < last && *p == '.')
+	{
+		for (++p; p < last && *p >= '0' && *p <= '9'; ++p, ++nDigits, --exponent)
+		{
+			mantissa = (mantissa * 10) + (*p - '0');
+		}
+	}
+	if (nDigits > 0 && p < last && (*p == 'e' || *p == 'E'))
+	{
+		++p;
+		bool negativeExp = (p < last && *p == '-');
+		if (p < last && (*p == '-' || *p == '+'))
+		{
+			++p;
+		}
+		int exp = 0;
+		const char *expDigits = p;
+		for (; p < last && *p >= '0' && *p <= '9'; ++p)
+		{
+			exp = (exp < 10000) ? (exp * 10) + (*p - '0') : exp;
+		}
+		exponent += (p == expDigits) ? 100000 : (negativeExp ? -exp : exp);
+	}
+
+	// Fast path. With more than 19 digits the mantissa could have overflowed
+	if (nDigits > 0 && nDigits <= 19 && p == last && mantissa <= (1 << 24) && exponent >= -10 && exponent <= 10)
+	{
+		float m = (float)mantissa;
+		*value = (exponent < 0) ? m / powersOf10[-exponent] : m * powersOf10[exponent];
+		*value = (negative) ? -(*value) : *value;
+		return true;
+	}
+
+	// Slow path (long mantissas, big exponents, 'inf', 'nan'...)
+	char *next;
+	*value = strtof(first, &next);
+	return next == last;
+}
+
+/**
+ * @brief Gets the end of the token which starts at a position
+ * @param p The first character of the token
+ * @param eol The end of the line
+ * @return The character following the token
+ */
+static inline const char *tokenEnd(const char *p, const char *const eol)
+{
+	while (p < eol && !isBlank(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+/**
+ * @brief Gets the first character of the next token of a line
+ * @param p The current position
+ * @param eol The end of the line
+ * @return The first character of the next token or 'eol' if there are no more tokens
+ */
+static inline const char *nextToken(const char *p, const char *const eol)
+{
+	while (p < eol && isBlank(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+/**
+ * @brief Gets the end of a line
+ * @param p A position inside the line
+ * @param end The end of the buffer
+ * @return The position of the newline character or 'end'
+ */
+static inline const char *lineEnd(const char *const p, const char *const end)
+{
+	const char *eol = (const char *)memchr(p, '\n', end - p);
+	return (eol == NULL) ? end : eol;
+}
+
+/**
+ * @brief Reads a text database
+ *
+ * The file is split at line boundaries into one chunk per OpenMP thread. A first pass counts the rows and the values of
+ * each row of every chunk, so each chunk knows where its rows start. A second pass parses the values straight into the
+ * final array. Blank lines are ignored
+ * @param fileName The name of the file containing the database
+ * @param nRows Where the number of rows is stored
+ * @param nCols Where the number of columns is stored
+ * @return The database with all its instances
+ */
+float *readTextDataBase(const char *const fileName, int *const nRows, int *const nCols)
+{
+
+	/********** Load the whole file ***********/
+
+	FILE *f = fopen(fileName, "rb");
+	check(f == NULL, "%s\n", BD_ERROR_FILE_OPEN);
+	fseek(f, 0, SEEK_END);
+	long int size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	std::vector<char> buffer(size + 1);
+	size_t nRead = fread(buffer.data(), 1, size, f);
+	fclose(f);
+	buffer[nRead] = '\0';
+	const char *const begin = buffer.data();
+	const char *const end = begin + nRead;
+
+	/********** Split the file into chunks of whole lines ***********/
+
+	int nChunks = std::max(1, std::min(omp_get_max_threads(), (int)(nRead >> 16)));
+	std::vector<const char *> chunkBegin(nChunks + 1);
+	chunkBegin[0] = begin;
+	chunkBegin[nChunks] = end;
+	for (int c = 1; c < nChunks; ++c)
+	{
+		const char *p = std::max(begin + (nRead * c) / nChunks, chunkBegin[c - 1]);
+		p = lineEnd(p, end);
+		chunkBegin[c] = (p < end) ? p + 1 : end;
+	}
+
+	/********** First pass: count rows and validate the number of columns ***********/
+
+	// Number of rows and values in the first row of each chunk, and first row with a different number of values
+	std::vector<int> chunkRows(nChunks, 0);
+	std::vector<int> chunkCols(nChunks, -1);
+	std::vector<int> chunkBadRow(nChunks, -1);
+
+	#pragma omp parallel for num_threads(nChunks) schedule(static, 1)
+	for (int c = 0; c < nChunks; ++c)
+	{
+		for (const char *p = chunkBegin[c]; p < chunkBegin[c + 1];)
+		{
+			const char *eol = lineEnd(p, chunkBegin[c + 1]);
+			int nValues = 0;
+			for (p = nextToken(p, eol); p < eol; p = nextToken(tokenEnd(p, eol), eol))
+			{
+				++nValues;
+			}
+			p = eol + 1;
+
+			if (nValues > 0)
+			{
+				if (chunkCols[c] < 0)
+				{
+					chunkCols[c] = nValues;
+				}
+				else if (nValues != chunkCols[c] && chunkBadRow[c] < 0)
+				{
+					chunkBadRow[c] = chunkRows[c];
+				}
+				++chunkRows[c];
+			}
+		}
+	}
+
+	// The first row of the file gives the number of columns. Rows are numbered from 1 in the error messages
+	std::vector<int> chunkFirstRow(nChunks + 1, 0);
+	*nCols = 0;
+	for (int c = 0; c < nChunks; ++c)
+	{
+		if (*nCols == 0 && chunkCols[c] > 0)
+		{
+			*nCols = chunkCols[c];
+		}
+		check(chunkCols[c] > 0 && chunkCols[c] != *nCols, "%s %d\n", BD_ERROR_ROW_UNEQUAL, chunkFirstRow[c] + 1);
+		check(chunkBadRow[c] >= 0, "%s %d\n", BD_ERROR_ROW_UNEQUAL, chunkFirstRow[c] + chunkBadRow[c] + 1);
+		chunkFirstRow[c + 1] = chunkFirstRow[c] + chunkRows[c];
+	}
+	*nRows = chunkFirstRow[nChunks];
+	check(*nRows == 0, "%s\n", BD_ERROR_FILE_EMPTY);
+
+	/********** Second pass: parse the values into the database ***********/
+
+	float *dataBase = new float[(size_t)(*nRows) * (*nCols)];
+	std::vector<int> chunkBadValue(nChunks, -1);
+
+	#pragma omp parallel for num_threads(nChunks) schedule(static, 1)
+	for (int c = 0; c < nChunks; ++c)
+	{
+		float *row = dataBase + (size_t)chunkFirstRow[c] * (*nCols);
+		int nParsedRows = 0;
+		for (const char *p = chunkBegin[c]; p < chunkBegin[c + 1] && chunkBadValue[c] < 0;)
+		{
+			const char *eol = lineEnd(p, chunkBegin[c + 1]);
+			int nValues = 0;
+			for (p = nextToken(p, eol); p < eol; p = nextToken(p, eol))
+			{
+				const char *last = tokenEnd(p, eol);
+				if (!parseFloat(p, last, &row[nValues]))
+				{
+					chunkBadValue[c] = nParsedRows;
+				}
+				++nValues;
+				p = last;
+			}
+			p = eol + 1;
+
+			if (nValues > 0)
+			{
+				row += *nCols;
+				++nParsedRows;
+			}
+		}
+	}
+
+	for (int c = 0; c < nChunks; ++c)
+	{
+		check(chunkBadValue[c] >= 0, "%s %d\n", BD_ERROR_VALUE_PARSE, chunkFirstRow[c] + chunkBadValue[c] + 1);
+	}
+
+	return dataBase;
+}
+
+/**
+ * @brief Writes a database in binary format. The file is written under a temporary name and then renamed
+ * @param fileName The name of the binary file
+ * @param dataBase The database
+ * @param nRows The number of rows
+ * @param nCols The number of columns
+ * @param normalized If the values are already normalized
+ * @return true if the file has been written
+ */
+bool writeBinaryDataBase(const char *const fileName, const float *const dataBase, const int nRows, const int nCols, const bool normalized)
+{
+
+	BinaryDataBaseHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BD_BINARY_MAGIC, sizeof(header.magic));
+	header.version = BD_BINARY_VERSION;
+	header.dtype = BD_DTYPE_FLOAT32;
+	header.normalized = normalized;
+	header.nRows = nRows;
+	header.nCols = nCols;
+
+	// Other processes never see a partially written file
+	std::stringstream tmpFileName;
+	tmpFileName << fileName << "." << getpid() << ".tmp";
+	FILE *f = fopen(tmpFileName.str().c_str(), "wb");
+	if (f == NULL)
+	{
+		return false;
+	}
+	size_t nValues = (size_t)nRows * nCols;
+	bool written = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(dataBase, sizeof(float), nValues, f) == nValues;
+	written &= (fclose(f) == 0);
+	written = written && rename(tmpFileName.str().c_str(), fileName) == 0;
+	if (!written)
+	{
+		remove(tmpFileName.str().c_str());
+	}
+	return written;
+}
+
+/**
+ * @brief Reads the header of a binary database
+ * @param fileName The name of the binary file
+ * @param header Where the header of the database is stored
+ * @return true if the header is supported
+ */
+static bool readBinaryHeader(const char *const fileName, BinaryDataBaseHeader *const header)
+{
+
+	FILE *f = fopen(fileName, "rb");
+	bool valid = (f != NULL && fread(header, sizeof(BinaryDataBaseHeader), 1, f) == 1 && memcmp(header->magic, BD_BINARY_MAGIC, sizeof(header->magic)) == 0 &&
+				  header->version == BD_BINARY_VERSION && header->dtype == BD_DTYPE_FLOAT32);
+	if (f != NULL)
+	{
+		fclose(f);
+	}
+	return valid;
+}
+
+/**
+ * @brief Gets the number of columns (features) of the training database without reading the whole database
+ *
+ * Binary databases (and the binary cache of text databases) store it in their header. In text databases, the values of the first non-blank line are counted
+ * @param conf The structure with all configuration parameters
+ * @return The number of columns
+ */
+int getDataBaseColumns(const Config *const conf)
+{
+
+	const char *const fileName = conf->trDataBaseFileName.c_str();
+	std::string cacheFileName = conf->trDataBaseFileName + BD_CACHE_EXTENSION;
+	BinaryDataBaseHeader header;
+	if (isBinaryDataBase(fileName))
+	{
+		check(!readBinaryHeader(fileName, &header), "%s\n", BD_ERROR_BINARY_INVALID);
+		return header.nCols;
+	}
+	else if (conf->trCache && isCacheUpToDate(fileName, cacheFileName.c_str()) && readBinaryHeader(cacheFileName.c_str(), &header))
+	{
+		return header.nCols;
+	}
+
+	FILE *f = fopen(fileName, "rb");
+	check(f == NULL, "%s\n", BD_ERROR_FILE_OPEN);
+	int nCols = 0;
+	bool inToken = false;
+	for (int c = fgetc(f); c != EOF && !(c == '\n' && nCols > 0); c = fgetc(f))
+	{
+		bool blank = (c == '\n' || isBlank(c));
+		nCols += (!blank && !inToken);
+		inToken = !blank;
+	}
+	fclose(f);
+	check(nCols == 0, "%s\n", BD_ERROR_FILE_EMPTY);
+
+	return nCols;
+}
+
 /**
  * @brief Reads and normalizes a database if it is required
+ *
+ * Binary databases (and the binary cache of text databases) are memory-mapped without parsing
  * @param conf The structure with all configuration parameters
  * @return The database which will contain the instances
  */
@@ -78,62 +520,202 @@ float *getDataBase(const Config *const conf)
 
 	/********** Open the database ***********/
 
-	std::fstream fData(conf->trDataBaseFileName.c_str(), std::fstream::in);
-	check(!fData.is_open(), "%s\n", BD_ERROR_FILE_OPEN);
-
-	/********** Getting the database dimensions ***********/
-
-	int nRows = 1, nCols = 0;
-	float dato;
-	std::string line;
-	if (!getline(fData, line))
+	const char *const fileName = conf->trDataBaseFileName.c_str();
+	std::string cacheFileName = conf->trDataBaseFileName + BD_CACHE_EXTENSION;
+	BinaryDataBaseHeader header;
+	float *dataBase = NULL;
+	int nRows, nCols;
+	bool normalized = false;
+	if (isBinaryDataBase(fileName))
 	{
-		fData.close();
-		check(true, "%s\n", BD_ERROR_FILE_EMPTY);
+		dataBase = mapBinaryDataBase(fileName, &header);
+		check(dataBase == NULL, "%s\n", BD_ERROR_BINARY_INVALID);
 	}
-
-	std::stringstream ss(line);
-	while (ss >> dato)
+	else if (conf->trCache && isCacheUpToDate(fileName, cacheFileName.c_str()))
 	{
-		++nCols;
+
+		// An invalid cache is ignored and rewritten
+		dataBase = mapBinaryDataBase(cacheFileName.c_str(), &header);
 	}
 
-	while (getline(fData, line))
+	if (dataBase != NULL)
+	{
+		nRows = header.nRows;
+		nCols = header.nCols;
+		normalized = header.normalized;
+	}
+	else
 	{
-		++nRows;
-		std::stringstream aux(line);
-		int tmp = 0;
-		while (aux >> dato)
+		dataBase = readTextDataBase(fileName, &nRows, &nCols);
+
+		// Only one process writes the cache: the first worker if each worker reads the file, or the master otherwise
+		int cacheWriter = (conf->mpiSize > 1 && conf->trDistribution == TR_DIST_LOCAL) ? 1 : 0;
+		if (conf->trCache && conf->mpiRank == cacheWriter)
 		{
-			++tmp;
+			if (!writeBinaryDataBase(cacheFileName.c_str(), dataBase, nRows, nCols, false))
+			{
+				fprintf(stderr, "Process %d: %s %s\n", conf->mpiRank, BD_WARNING_CACHE_WRITE, cacheFileName.c_str());
+			}
 		}
-		check(tmp != nCols, "%s %d\n", BD_ERROR_ROW_UNEQUAL, nRows);
 	}
 
 	/********** Check the parameters specified in configuration ***********/
 
 	check(nRows < 4 || nCols < 4, "%s\n", BD_ERROR_DIMENSIONS_MIN);
 	check(conf->trNInstances < 4 || conf->trNInstances > nRows, "%s %d\n", BD_ERROR_INSTANCES_RANGE, nRows);
-	check(conf->nFeatures != nCols, "%s\n", BD_ERROR_COLUMNS_UNEQUAL);
+	check(conf->nFeatures != nCols, "%s %d\n", BD_ERROR_COLUMNS_UNEQUAL, conf->nFeatures);
+	check(normalized && (!conf->trNormalize || conf->trNInstances != nRows), "%s\n", BD_ERROR_BINARY_NORMALIZED);
+
+	// Normalize the database if it is required and return it
+	if (conf->trNormalize && !normalized)
+	{
+		normDataBase(dataBase, conf);
+	}
+	return dataBase;
+}
+
+/**
+ * @brief Releases a database read by the process, either memory-mapped or allocated
+ * @param dataBase The database to be released
+ */
+static void releaseDataBase(const float *const dataBase)
+{
 
-	/********** Reading and database storage ***********/
+	if (mappedFile != NULL && (const char *)dataBase == (const char *)mappedFile + sizeof(BinaryDataBaseHeader))
+	{
+		munmap(mappedFile, mappedLength);
+		mappedFile = NULL;
+		mappedLength = 0;
+	}
+	else
+	{
+		delete[] dataBase;
+	}
+}
 
-	fData.clear();
-	fData.seekg(0);
-	int dbSize = conf->trNInstances * nCols;
-	float *dataBase = new float[dbSize];
-	for (int i = 0; i < dbSize; ++i)
+/**
+ * @brief Broadcasts an array of floats. Big arrays are sent in several messages, since the count of MPI is an 'int'
+ * @param data The array
+ * @param nValues The number of values
+ * @param comm The communicator. The root is the process 0
+ */
+static void bcastFloats(float *const data, const size_t nValues, MPI_Comm comm)
+{
+
+	const size_t maxCount = 1 << 30;
+	for (size_t first = 0; first < nValues; first += maxCount)
 	{
-		fData >> dataBase[i];
+		MPI_Bcast(data + first, (int)std::min(maxCount, nValues - first), MPI_FLOAT, 0, comm);
 	}
-	fData.close();
+}
 
-	// Normalize the database if it is required and return it
+/**
+ * @brief Gets the training database in all the processes which need it. It must be called by all processes
+ *
+ * With TR_DIST_LOCAL each worker reads the file. With TR_DIST_BCAST the master reads (and normalizes) it once and
+ * broadcasts it. With TR_DIST_SHARED the master broadcasts it only to one process per node, which stores it in an MPI
+ * shared memory window used by the rest of processes of the node
+ * @param conf The structure with all configuration parameters
+ * @return The database, or NULL in the master process if it does not evaluate
+ */
+float *distributeDataBase(const Config *const conf)
+{
+
+	bool master = (conf->mpiRank == 0);
+	bool evaluates = (!master || conf->mpiSize == 1);
+	if (conf->trDistribution == TR_DIST_LOCAL || conf->mpiSize == 1)
+	{
+		return (evaluates) ? getDataBase(conf) : NULL;
+	}
+
+	size_t nValues = (size_t)conf->trNInstances * conf->nFeatures;
+	float *dataBase = (master) ? getDataBase(conf) : NULL;
+	if (conf->trDistribution == TR_DIST_BCAST)
+	{
+		if (!master)
+		{
+			dataBase = new float[nValues];
+		}
+		bcastFloats(dataBase, nValues, MPI_COMM_WORLD);
+		if (master)
+		{
+			releaseDataBase(dataBase);
+			dataBase = NULL;
+		}
+		return dataBase;
+	}
+
+	// One process per node (the one with the lowest rank) allocates the window. The master is always one of them
+	MPI_Comm nodeComm, leadersComm;
+	int nodeRank;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, conf->mpiRank, MPI_INFO_NULL, &nodeComm);
+	MPI_Comm_rank(nodeComm, &nodeRank);
+	MPI_Comm_split(MPI_COMM_WORLD, (nodeRank == 0) ? 0 : MPI_UNDEFINED, conf->mpiRank, &leadersComm);
+
+	float *sharedDataBase;
+	MPI_Win_allocate_shared((nodeRank == 0) ? nValues * sizeof(float) : 0, sizeof(float), MPI_INFO_NULL, nodeComm, &sharedDataBase, &sharedWindow);
+	if (nodeRank != 0)
+	{
+		MPI_Aint size;
+		int dispUnit;
+		MPI_Win_shared_query(sharedWindow, 0, &size, &dispUnit, &sharedDataBase);
+	}
+
+	MPI_Win_fence(0, sharedWindow);
+	if (master)
+	{
+		std::copy(dataBase, dataBase + nValues, sharedDataBase);
+		releaseDataBase(dataBase);
+	}
+	if (leadersComm != MPI_COMM_NULL)
+	{
+		bcastFloats(sharedDataBase, nValues, leadersComm);
+		MPI_Comm_free(&leadersComm);
+	}
+	MPI_Win_fence(0, sharedWindow);
+	MPI_Comm_free(&nodeComm);
+
+	return sharedDataBase;
+}
+
+/**
+ * @brief Releases a database returned by 'getDataBase' or 'distributeDataBase'. It must be called by all processes if the database is shared
+ * @param dataBase The database to be released
+ */
+void freeDataBase(const float *const dataBase)
+{
+
+	if (sharedWindow != MPI_WIN_NULL)
+	{
+		MPI_Win_free(&sharedWindow);
+	}
+	else
+	{
+		releaseDataBase(dataBase);
+	}
+}
+
+/**
+ * @brief Converts the training database to binary format. The database is normalized only if it is required
+ * @param conf The structure with all configuration parameters
+ */
+void convertDataBase(const Config *const conf)
+{
+
+	// Normalization depends on the number of instances, so a normalized database only keeps the instances used
+	int nRows, nCols;
+	float *dataBase = readTextDataBase(conf->trDataBaseFileName.c_str(), &nRows, &nCols);
+	check(nRows < 4 || nCols < 4, "%s\n", BD_ERROR_DIMENSIONS_MIN);
+	check(conf->nFeatures != nCols, "%s %d\n", BD_ERROR_COLUMNS_UNEQUAL, conf->nFeatures);
 	if (conf->trNormalize)
 	{
+		check(conf->trNInstances < 4 || conf->trNInstances > nRows, "%s %d\n", BD_ERROR_INSTANCES_RANGE, nRows);
+		nRows = conf->trNInstances;
 		normDataBase(dataBase, conf);
 	}
-	return dataBase;
+
+	check(!writeBinaryDataBase(conf->trConvFileName.c_str(), dataBase, nRows, nCols, conf->trNormalize), "%s\n", BD_ERROR_FILE_WRITE);
+	delete[] dataBase;
 }
 
 /**
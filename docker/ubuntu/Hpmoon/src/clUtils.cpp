@@ -18,29 +18,339 @@
 /********************************* Includes *******************************/
 
 #include "clUtils.h"
+#include "random.h" // RandomGenerator
 #include <string>
 #include <iostream>
+#include <algorithm>	// std::min
+#include <fcntl.h>		// open
+#include <sstream>		// stringstream
+#include <stdint.h>		// uint32_t, uint64_t
+#include <stdio.h>		// fopen, fread, rename...
+#include <string.h>		// memcmp
+#include <sys/file.h>	// flock
+#include <sys/stat.h>	// mkdir, fstat
+#include <unistd.h>		// getpid, ftruncate
 #include <log_config.h> // LOG_ENABLED
 
 /********************************* Methods ********************************/
 
+/**
+ * @brief Gets the 64-bit FNV-1a hash of a block of bytes
+ * @param data The block of bytes
+ * @param size The size in bytes of the block
+ * @return The hash
+ */
+static uint64_t hashBytes(const char *const data, const size_t size)
+{
+
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ (unsigned char)data[i]) * 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Gets the driver version of a device
+ * @param device The OpenCL device
+ * @return The driver version
+ */
+static std::string getDriverVersion(const CLDevice &device)
+{
+
+	char driverVersion[128];
+	check(clGetDeviceInfo(device.device, CL_DRIVER_VERSION, sizeof(driverVersion), driverVersion, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DRIVER_VERSION);
+
+	return driverVersion;
+}
+
+/**
+ * @brief Gets the key which identifies the program binary of a device: device name, driver version, build options and hash of the kernels source
+ * @param device The OpenCL device
+ * @param kernelSource The source code of the kernels
+ * @param sourceSize The size in bytes of the source code
+ * @param buildOptions The options used to build the program
+ * @return The key of the program binary
+ */
+static std::string getProgramKey(const CLDevice &device, const char *const kernelSource, const size_t sourceSize, const char *const buildOptions)
+{
+
+	std::stringstream key;
+	key << device.deviceName << "\n" << getDriverVersion(device) << "\n" << buildOptions << "\n" << std::hex << hashBytes(kernelSource, sourceSize);
+
+	return key.str();
+}
+
+/**
+ * @brief Gets the name of the file where the program binary with the given key is cached
+ * @param cacheDir The directory of the cache
+ * @param key The key of the program binary
+ * @return The name of the file
+ */
+static std::string getProgramCacheFileName(const std::string &cacheDir, const std::string &key)
+{
+
+	std::stringstream fileName;
+	fileName << cacheDir << "/" << std::hex << hashBytes(key.c_str(), key.size()) << CL_CACHE_EXTENSION;
+
+	return fileName.str();
+}
+
+/**
+ * @brief Creates and builds the program of a device from its cached binary
+ *
+ * The file stores the signature, the key and the binary. The key is compared in full, so a collision of the file name is a miss
+ * @param device The OpenCL device
+ * @param fileName The name of the cached file
+ * @param key The key of the program binary
+ * @param buildOptions The options used to build the program
+ * @return The program already built or NULL if the binary is not cached or the driver rejects it
+ */
+static cl_program loadProgramBinary(const CLDevice &device, const std::string &fileName, const std::string &key, const char *const buildOptions)
+{
+
+	FILE *f = fopen(fileName.c_str(), "rb");
+	if (f == NULL)
+	{
+		return NULL;
+	}
+
+	// The sizes read from the file are checked before allocating anything, since a truncated or corrupt file must only be a miss
+	struct stat st;
+	char magic[8];
+	uint32_t keySize;
+	uint64_t binarySize;
+	std::string cachedKey;
+	unsigned char *binary = NULL;
+	bool valid = fstat(fileno(f), &st) == 0 && fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, CL_BINARY_MAGIC, sizeof(magic)) == 0 && fread(&keySize, sizeof(keySize), 1, f) == 1 && keySize == key.size();
+	if (valid)
+	{
+		cachedKey.resize(keySize);
+		valid = fread(&cachedKey[0], 1, keySize, f) == keySize && cachedKey == key && fread(&binarySize, sizeof(binarySize), 1, f) == 1 && binarySize > 0;
+	}
+	if (valid)
+	{
+		const uint64_t headerSize = sizeof(magic) + sizeof(keySize) + keySize + sizeof(binarySize);
+		valid = (uint64_t)st.st_size >= headerSize && binarySize == (uint64_t)st.st_size - headerSize;
+	}
+	if (valid)
+	{
+		binary = new unsigned char[binarySize];
+		valid = fread(binary, 1, binarySize, f) == binarySize;
+	}
+	fclose(f);
+
+	// The binary must be accepted and built by the driver. Otherwise, the program is compiled from source
+	cl_program program = NULL;
+	if (valid)
+	{
+		cl_int status, binaryStatus;
+		size_t size = binarySize;
+		program = clCreateProgramWithBinary(device.context, 1, &(device.device), &size, (const unsigned char **)&binary, &binaryStatus, &status);
+		if (status != CL_SUCCESS || binaryStatus != CL_SUCCESS)
+		{
+			program = NULL;
+		}
+		else if (clBuildProgram(program, 1, &(device.device), buildOptions, 0, 0) != CL_SUCCESS)
+		{
+			clReleaseProgram(program);
+			program = NULL;
+		}
+	}
+	delete[] binary;
+
+	return program;
+}
+
+/**
+ * @brief Writes the binary of a built program to the cache. Other processes never see a partially written file
+ * @param program The program already built for a single device
+ * @param fileName The name of the cached file
+ * @param key The key of the program binary
+ * @return true if the binary has been written
+ */
+static bool saveProgramBinary(const cl_program program, const std::string &fileName, const std::string &key)
+{
+
+	size_t size;
+	if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &size, NULL) != CL_SUCCESS || size == 0)
+	{
+		return false;
+	}
+	unsigned char *binary = new unsigned char[size];
+	bool written = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char *), &binary, NULL) == CL_SUCCESS;
+
+	std::stringstream tmpFileName;
+	tmpFileName << fileName << "." << getpid() << ".tmp";
+	FILE *f = (written) ? fopen(tmpFileName.str().c_str(), "wb") : NULL;
+	if (f != NULL)
+	{
+		uint32_t keySize = key.size();
+		uint64_t binarySize = size;
+		written = fwrite(CL_BINARY_MAGIC, 1, 8, f) == 8 && fwrite(&keySize, sizeof(keySize), 1, f) == 1 && fwrite(key.c_str(), 1, keySize, f) == keySize &&
+				  fwrite(&binarySize, sizeof(binarySize), 1, f) == 1 && fwrite(binary, 1, size, f) == size;
+		written &= (fclose(f) == 0);
+		written = written && rename(tmpFileName.str().c_str(), fileName.c_str()) == 0;
+		if (!written)
+		{
+			remove(tmpFileName.str().c_str());
+		}
+	}
+	delete[] binary;
+
+	return f != NULL && written;
+}
+
+/**
+ * @brief Gets the key which identifies the tuned values of a device in the tuning profile: device name, driver version and database dimensions, separated by tabs
+ * @param device The OpenCL device
+ * @param conf The structure with all configuration parameters
+ * @return The key, followed by a tab
+ */
+static std::string getTuningKey(const CLDevice &device, const Config *const conf)
+{
+
+	std::stringstream key;
+	key << device.deviceName << "\t" << getDriverVersion(device) << "\t" << conf->trNInstances << "\t" << conf->nFeatures << "\t" << conf->K << "\t";
+
+	return key.str();
+}
+
+/**
+ * @brief Replaces the configured work-groups and work-items of a device by its tuned values, if the tuning profile has them
+ * @param device The OpenCL device
+ * @param conf The structure with all configuration parameters
+ * @return true if the device has been found in the tuning profile
+ */
+static bool loadTuning(CLDevice &device, const Config *const conf)
+{
+
+	std::ifstream profile(conf->tuningProfile.c_str());
+	std::string key = getTuningKey(device, conf);
+	std::string line;
+	while (getline(profile, line))
+	{
+		int computeUnits, wiLocal;
+		if (line.compare(0, key.size(), key) == 0 && sscanf(line.c_str() + key.size(), "%d\t%d", &computeUnits, &wiLocal) == 2 && computeUnits > 0 && wiLocal > 0)
+		{
+			device.computeUnits = computeUnits;
+			device.wiLocal = wiLocal;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Writes the work-groups and work-items of a device to the tuning profile, replacing its previous values
+ *
+ * The file is locked while it is rewritten, since the MPI processes of a node may tune their devices at the same time
+ * @param device The OpenCL device
+ * @param conf The structure with all configuration parameters
+ * @return true if the tuning profile has been written
+ */
+static bool saveTuning(const CLDevice &device, const Config *const conf)
+{
+
+	int fd = open(conf->tuningProfile.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+	{
+		return false;
+	}
+	bool saved = flock(fd, LOCK_EX) == 0;
+
+	// The entries of the rest of devices are kept
+	std::string content;
+	char buffer[4096];
+	for (ssize_t n = read(fd, buffer, sizeof(buffer)); saved && n > 0; n = read(fd, buffer, sizeof(buffer)))
+	{
+		content.append(buffer, n);
+	}
+	std::string key = getTuningKey(device, conf);
+	std::stringstream in(content), out;
+	std::string line;
+	out << "# Device\tDriver\tInstances\tFeatures\tK\tComputeUnits\tWiLocal\n";
+	while (getline(in, line))
+	{
+		if (!line.empty() && line[0] != '#' && line.compare(0, key.size(), key) != 0)
+		{
+			out << line << "\n";
+		}
+	}
+	out << key << device.computeUnits << "\t" << device.wiLocal << "\n";
+
+	std::string profile = out.str();
+	saved = saved && ftruncate(fd, 0) == 0 && pwrite(fd, profile.c_str(), profile.size(), 0) == (ssize_t)profile.size();
+	saved &= (close(fd) == 0);
+
+	return saved;
+}
+
+/**
+ * @brief Times the kernel of a device on the individuals already uploaded
+ * @param device The OpenCL device
+ * @param wiGlobal The number of global work-items
+ * @param wiLocal The number of local work-items
+ * @return The fastest time in milliseconds of 'CL_TUNING_REPETITIONS' runs, or a negative value if the kernel can not run with these work-items
+ */
+static double timeKernel(const CLDevice &device, size_t wiGlobal, size_t wiLocal)
+{
+
+	// The first run warms up the device
+	double best = -1.0;
+	for (int r = 0; r <= CL_TUNING_REPETITIONS; ++r)
+	{
+		cl_event event;
+		if (clEnqueueNDRangeKernel(device.commandQueue, device.kernel, 1, NULL, &wiGlobal, &wiLocal, 0, NULL, &event) != CL_SUCCESS)
+		{
+			return -1.0;
+		}
+		if (clWaitForEvents(1, &event) != CL_SUCCESS)
+		{
+			clReleaseEvent(event);
+			return -1.0;
+		}
+
+		cl_ulong start, end;
+		check(clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_PROFILING);
+		check(clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_PROFILING);
+		clReleaseEvent(event);
+
+		double milliseconds = (end - start) * 1e-6;
+		if (r > 0 && (best < 0.0 || milliseconds < best))
+		{
+			best = milliseconds;
+		}
+	}
+
+	return best;
+}
+
 /**
  * @brief The destructor
  */
 CLDevice::~CLDevice()
 {
 
-	if (this->device != NULL && this->deviceType != CL_DEVICE_TYPE_CPU)
+	if (this->isOpenCL)
 	{
 
 		// Resources used are released
 		clReleaseContext(this->context);
 		clReleaseCommandQueue(this->commandQueue);
+		clReleaseCommandQueue(this->transferQueue);
 		clReleaseKernel(this->kernel);
 		clReleaseMemObject(this->objTrDataBase);
 		clReleaseMemObject(this->objTransposedTrDataBase);
 		clReleaseMemObject(this->objSelInstances);
-		clReleaseMemObject(this->objSubpopulations);
+		clReleaseMemObject(this->objChromosomes);
+		clReleaseMemObject(this->objFitness);
+		clReleaseMemObject(this->objIterations);
+		delete[] this->hostFitness;
+		delete[] this->hostIterations;
 	}
 }
 
@@ -98,10 +408,12 @@ CLDevice *createDevices(const float *const trDataBase, const int *const selInsta
 				devices[dev].device = allDevices[allDev];
 				devices[dev].deviceName = dbuff;
 				check(clGetDeviceInfo(devices[dev].device, CL_DEVICE_TYPE, sizeof(cl_device_type), &(devices[dev].deviceType), NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_TYPE);
+				devices[dev].isOpenCL = true;
+				devices[dev].throughput = 0.0;
 
 				/********** Device local memory usage ***********/
 
-				long int usedMemory = conf->nFeatures * sizeof(cl_uchar);	// Chromosome of the individual
+				long int usedMemory = conf->nWords * sizeof(cl_ulong);		// Chromosome of the individual (bit-packed)
 				usedMemory += conf->trNInstances * sizeof(cl_uchar);		// Mapping buffer
 				usedMemory += conf->K * conf->nFeatures * sizeof(cl_float); // Centroids buffer
 				usedMemory += conf->trNInstances * sizeof(cl_float);		// DistCentroids buffer
@@ -111,21 +423,25 @@ CLDevice *createDevices(const float *const trDataBase, const int *const selInsta
 				long int maxMemory;
 				check(clGetDeviceInfo(devices[dev].device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(long int), &maxMemory, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_MAXMEM);
 
-				// Avoid exceeding the maximum local memory available. 1024 bytes of margin
-				check(usedMemory > maxMemory - 1024, "%s:\n\tMax memory: %ld bytes\n\tAllow memory: %ld bytes\n\tUsed memory: %ld bytes\n", CL_ERROR_DEVICE_LOCALMEM, maxMemory, maxMemory - 1024, usedMemory);
+				// Avoid exceeding the maximum local memory available. 1024 bytes of margin. The CPU kernel keeps its buffers in private memory
+				check(devices[dev].deviceType != CL_DEVICE_TYPE_CPU && usedMemory > maxMemory - 1024, "%s:\n\tMax memory: %ld bytes\n\tAllow memory: %ld bytes\n\tUsed memory: %ld bytes\n", CL_ERROR_DEVICE_LOCALMEM, maxMemory, maxMemory - 1024, usedMemory);
 
 				/********** Create context ***********/
 
 				devices[dev].context = clCreateContext(NULL, 1, &(devices[dev].device), 0, 0, &status);
 				check(status != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_CONTEXT);
 
-				/********** Create command queue ***********/
+				/********** Create the command queues (kernels and transfers) ***********/
 
 #ifdef CL_VERSION_2_0
-				const cl_command_queue_properties properties[] = {CL_QUEUE_PROFILING_ENABLE};
+				const cl_command_queue_properties properties[] = {CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0};
 				devices[dev].commandQueue = clCreateCommandQueueWithProperties(devices[dev].context, devices[dev].device, properties, &status);
+				check(status != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_QUEUE);
+				devices[dev].transferQueue = clCreateCommandQueueWithProperties(devices[dev].context, devices[dev].device, properties, &status);
 #else
 				devices[dev].commandQueue = clCreateCommandQueue(devices[dev].context, devices[dev].device, CL_QUEUE_PROFILING_ENABLE, &status);
+				check(status != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_QUEUE);
+				devices[dev].transferQueue = clCreateCommandQueue(devices[dev].context, devices[dev].device, CL_QUEUE_PROFILING_ENABLE, &status);
 #endif
 				check(status != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_QUEUE);
 
@@ -144,24 +460,52 @@ CLDevice *createDevices(const float *const trDataBase, const int *const selInsta
 				kernels.read(kernelSource, fSize);
 				kernels.close();
 
-				// Create program
-				program = clCreateProgramWithSource(devices[dev].context, 1, (const char **)&kernelSource, &fSize, &status);
-				check(status != CL_SUCCESS, "%s\n", CL_ERROR_PROGRAM_BUILD);
-
-				// Build program for the device in the context
 				char buildOptions[196];
-				sprintf(buildOptions, "-I include -D N_INSTANCES=%d -D N_FEATURES=%d -D N_OBJECTIVES=%d -D K=%d -D MAX_ITER_KMEANS=%d", conf->trNInstances, conf->nFeatures, conf->nObjectives, conf->K, conf->maxIterKmeans);
-				if (clBuildProgram(program, 1, &(devices[dev].device), buildOptions, 0, 0) != CL_SUCCESS)
+				sprintf(buildOptions, "-I include -D N_INSTANCES=%d -D N_FEATURES=%d -D N_WORDS=%d -D N_OBJECTIVES=%d -D K=%d -D MAX_ITER_KMEANS=%d", conf->trNInstances, conf->nFeatures, conf->nWords, conf->nObjectives, conf->K, conf->maxIterKmeans);
+
+				// Load the program from the binary cache if it has been built before with the same device, driver, source and options
+				std::string programKey, cacheFileName;
+				program = NULL;
+				if (!conf->kernelsCacheDir.empty())
 				{
-					char buffer[4096];
-					fprintf(stderr, "Error: Could not build the program\n");
-					check(clGetProgramBuildInfo(program, devices[dev].device, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_PROGRAM_ERRORS);
-					check(true, "%s\n", buffer);
+					programKey = getProgramKey(devices[dev], kernelSource, fSize, buildOptions);
+					cacheFileName = getProgramCacheFileName(conf->kernelsCacheDir, programKey);
+					program = loadProgramBinary(devices[dev], cacheFileName, programKey, buildOptions);
+#if LOG_ENABLED
+					std::cout << "Process " << conf->mpiRank << " [clUtils]: Program binary cache " << ((program == NULL) ? "miss" : "hit") << " for " << devices[dev].deviceName << " (" << cacheFileName << ")" << std::endl;
+#endif
+				}
+
+				if (program == NULL)
+				{
+
+					// Create program
+					program = clCreateProgramWithSource(devices[dev].context, 1, (const char **)&kernelSource, &fSize, &status);
+					check(status != CL_SUCCESS, "%s\n", CL_ERROR_PROGRAM_BUILD);
+
+					// Build program for the device in the context
+					if (clBuildProgram(program, 1, &(devices[dev].device), buildOptions, 0, 0) != CL_SUCCESS)
+					{
+						char buffer[4096];
+						fprintf(stderr, "Error: Could not build the program\n");
+						check(clGetProgramBuildInfo(program, devices[dev].device, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_PROGRAM_ERRORS);
+						check(true, "%s\n", buffer);
+					}
+
+					// Cache the binary for later runs. The directory is created if it does not exist
+					if (!conf->kernelsCacheDir.empty())
+					{
+						mkdir(conf->kernelsCacheDir.c_str(), 0755);
+						if (!saveProgramBinary(program, cacheFileName, programKey))
+						{
+							fprintf(stderr, "Process %d: %s %s\n", conf->mpiRank, CL_WARNING_CACHE_WRITE, cacheFileName.c_str());
+						}
+					}
 				}
 
 				/********** Create kernel ***********/
 
-				const char *kernelName = (devices[dev].deviceType == CL_DEVICE_TYPE_GPU) ? "kmeansGPU" : "";
+				const char *kernelName = (devices[dev].deviceType == CL_DEVICE_TYPE_CPU) ? "kmeansCPU" : "kmeansGPU";
 				devices[dev].kernel = clCreateKernel(program, kernelName, &status);
 				check(status != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_BUILD);
 
@@ -169,14 +513,31 @@ CLDevice *createDevices(const float *const trDataBase, const int *const selInsta
 
 				devices[dev].computeUnits = atoi(conf->computeUnits[dev].c_str());
 				devices[dev].wiLocal = atoi(conf->wiLocal[dev].c_str());
+
+				// The tuned values of the device replace the configured ones
+				if (!conf->tuningProfile.empty() && loadTuning(devices[dev], conf))
+				{
+#if LOG_ENABLED
+					std::cout << "Process " << conf->mpiRank << " [clUtils]: Tuned values for " << devices[dev].deviceName << ": ComputeUnits " << devices[dev].computeUnits << ", WiLocal " << devices[dev].wiLocal << std::endl;
+#endif
+				}
+
+				// Each work-group of the CPU kernel is a single work-item which computes a whole individual
+				if (devices[dev].deviceType == CL_DEVICE_TYPE_CPU)
+				{
+					devices[dev].wiLocal = 1;
+				}
 				devices[dev].wiGlobal = devices[dev].computeUnits * devices[dev].wiLocal;
 
 				/******* Create and write the databases and centroids buffers. Create the subpopulations buffer. Set kernel arguments *******/
 
 				// Create buffers
-				devices[dev].objSubpopulations = clCreateBuffer(devices[dev].context, CL_MEM_READ_WRITE, conf->familySize * sizeof(Individual), 0, &status);
+				devices[dev].objChromosomes = clCreateBuffer(devices[dev].context, CL_MEM_READ_ONLY, (size_t)conf->familySize * conf->nWords * sizeof(cl_ulong), 0, &status);
 				check(status != CL_SUCCESS, "%s\n", CL_ERROR_OBJECT_SUBPOPS);
 
+				devices[dev].objFitness = clCreateBuffer(devices[dev].context, CL_MEM_WRITE_ONLY, (size_t)conf->familySize * conf->nObjectives * sizeof(cl_float), 0, &status);
+				check(status != CL_SUCCESS, "%s\n", CL_ERROR_OBJECT_FITNESS);
+
 				devices[dev].objTrDataBase = clCreateBuffer(devices[dev].context, CL_MEM_READ_ONLY, conf->trNInstances * conf->nFeatures * sizeof(cl_float), 0, &status);
 				check(status != CL_SUCCESS, "%s\n", CL_ERROR_OBJECT_TRDB);
 
@@ -186,8 +547,15 @@ CLDevice *createDevices(const float *const trDataBase, const int *const selInsta
 				devices[dev].objSelInstances = clCreateBuffer(devices[dev].context, CL_MEM_READ_ONLY, conf->K * sizeof(cl_int), 0, &status);
 				check(status != CL_SUCCESS, "%s\n", CL_ERROR_OBJECT_CENTROIDS);
 
+				devices[dev].objIterations = clCreateBuffer(devices[dev].context, CL_MEM_WRITE_ONLY, conf->familySize * sizeof(cl_int), 0, &status);
+				check(status != CL_SUCCESS, "%s\n", CL_ERROR_OBJECT_ITERATIONS);
+
+				// Host buffers for the readings of two chunks at the same time
+				devices[dev].hostFitness = new float[2 * (size_t)conf->familySize * conf->nObjectives];
+				devices[dev].hostIterations = new int[2 * (size_t)conf->familySize];
+
 				// Sets kernel arguments
-				check(clSetKernelArg(devices[dev].kernel, 0, sizeof(cl_mem), (void *)&(devices[dev].objSubpopulations)) != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_ARGUMENT1);
+				check(clSetKernelArg(devices[dev].kernel, 0, sizeof(cl_mem), (void *)&(devices[dev].objChromosomes)) != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_ARGUMENT1);
 
 				check(clSetKernelArg(devices[dev].kernel, 1, sizeof(cl_mem), (void *)&(devices[dev].objSelInstances)) != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_ARGUMENT2);
 
@@ -195,6 +563,10 @@ CLDevice *createDevices(const float *const trDataBase, const int *const selInsta
 
 				check(clSetKernelArg(devices[dev].kernel, 5, sizeof(cl_mem), (void *)&(devices[dev].objTransposedTrDataBase)) != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_ARGUMENT6);
 
+				check(clSetKernelArg(devices[dev].kernel, 6, sizeof(cl_mem), (void *)&(devices[dev].objIterations)) != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_ARGUMENT7);
+
+				check(clSetKernelArg(devices[dev].kernel, 7, sizeof(cl_mem), (void *)&(devices[dev].objFitness)) != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_ARGUMENT8);
+
 				// Write buffers
 				check(clEnqueueWriteBuffer(devices[dev].commandQueue, devices[dev].objTrDataBase, CL_FALSE, 0, conf->trNInstances * conf->nFeatures * sizeof(cl_float), trDataBase, 0, NULL, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_ENQUEUE_TRDB);
 				check(clEnqueueWriteBuffer(devices[dev].commandQueue, devices[dev].objSelInstances, CL_FALSE, 0, conf->K * sizeof(cl_int), selInstances, 0, NULL, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_ENQUEUE_CENTROIDS);
@@ -221,6 +593,8 @@ CLDevice *createDevices(const float *const trDataBase, const int *const selInsta
 				  << conf->ompThreads << " threads as compute units." << std::endl;
 #endif
 		devices[conf->nDevices].deviceType = CL_DEVICE_TYPE_CPU;
+		devices[conf->nDevices].isOpenCL = false;
+		devices[conf->nDevices].throughput = 0.0;
 		devices[conf->nDevices].computeUnits = conf->ompThreads;
 		++(conf->nDevices);
 	}
@@ -228,6 +602,100 @@ CLDevice *createDevices(const float *const trDataBase, const int *const selInsta
 	return devices;
 }
 
+/**
+ * @brief Tunes the number of work-groups ('ComputeUnits') and local work-items ('WiLocal') of each OpenCL device
+ *
+ * The kernel is timed with profiling events on a synthetic population with the dimensions of the configuration. The best
+ * values replace the configured ones and are written to the tuning profile, which 'createDevices' loads in later runs
+ * @param devices The objects containing the OpenCL variables of each device
+ * @param conf The structure with all configuration parameters
+ */
+void tuneDevices(CLDevice *const devices, const Config *const conf)
+{
+
+	// Synthetic population initialized as the subpopulations, with a stream of its own
+	int nIndividuals = conf->familySize;
+	Population population(nIndividuals, conf);
+	Subpopulation synthetic = population.view(0);
+	RandomGenerator rng(conf->seed, RNG_TUNING, 0, 0);
+	for (int i = 0; i < nIndividuals; ++i)
+	{
+		for (int mf = 0; mf < conf->maxFeatures; ++mf)
+		{
+			selectFeature(synthetic.chromosome(i), rng.nextInt(conf->nFeatures));
+		}
+	}
+
+	int nTuned = 0;
+	for (int dev = 0; dev < conf->nDevices; ++dev)
+	{
+		CLDevice &device = devices[dev];
+		if (!device.isOpenCL)
+		{
+			continue;
+		}
+
+		int begin = 0;
+		check(clEnqueueWriteBuffer(device.commandQueue, device.objChromosomes, CL_TRUE, 0, (size_t)nIndividuals * conf->nWords * sizeof(cl_ulong), synthetic.chromosomes, 0, NULL, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_ENQUEUE_TUNING);
+		check(clSetKernelArg(device.kernel, 3, sizeof(int), &begin) != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_ARGUMENT4);
+		check(clSetKernelArg(device.kernel, 4, sizeof(int), &nIndividuals) != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_ARGUMENT5);
+
+		// The candidates are powers of 2 of work-items per work-group (only 1 for the CPU kernel) and multiples of the compute units of the device as work-groups
+		cl_uint maxCU;
+		size_t maxWorkGroup;
+		check(clGetDeviceInfo(device.device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &maxCU, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_MAXCU);
+		check(clGetKernelWorkGroupInfo(device.kernel, device.device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkGroup, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_KERNEL_WORKGROUP);
+		size_t maxWiLocal = (device.deviceType == CL_DEVICE_TYPE_CPU) ? 1 : maxWorkGroup;
+
+		double configured = timeKernel(device, device.wiGlobal, device.wiLocal);
+		double best = -1.0;
+		int bestComputeUnits = 0;
+		size_t bestWiLocal = 0;
+		for (size_t wiLocal = 1; wiLocal <= maxWiLocal; wiLocal *= 2)
+		{
+			for (int factor = 1; factor <= CL_TUNING_MAX_GROUPS_FACTOR; factor *= 2)
+			{
+
+				// More work-groups than individuals would be idle
+				int computeUnits = std::min(nIndividuals, (int)maxCU * factor);
+				double milliseconds = timeKernel(device, computeUnits * wiLocal, wiLocal);
+#if LOG_ENABLED
+				std::cout << "Process " << conf->mpiRank << " [clUtils]: " << device.deviceName << ": ComputeUnits " << computeUnits << ", WiLocal " << wiLocal << ": " << milliseconds << " ms" << std::endl;
+#endif
+				if (milliseconds >= 0.0 && (best < 0.0 || milliseconds < best))
+				{
+					best = milliseconds;
+					bestComputeUnits = computeUnits;
+					bestWiLocal = wiLocal;
+				}
+				if (computeUnits == nIndividuals)
+				{
+					break;
+				}
+			}
+		}
+		check(best < 0.0, "%s\n", CL_ERROR_TUNING_FAILED);
+
+		char configuredTime[32];
+		snprintf(configuredTime, sizeof(configuredTime), (configured >= 0.0) ? "%.3f ms" : "can not run", configured);
+		fprintf(stdout, "Process %d: Device '%s' tuned for %d individuals: ComputeUnits %d, WiLocal %zu (%.3f ms). Configured: ComputeUnits %d, WiLocal %zu (%s)\n", conf->mpiRank, device.deviceName.c_str(), nIndividuals, bestComputeUnits, bestWiLocal, best, device.computeUnits, device.wiLocal, configuredTime);
+		device.computeUnits = bestComputeUnits;
+		device.wiLocal = bestWiLocal;
+		device.wiGlobal = device.computeUnits * device.wiLocal;
+		++nTuned;
+
+		if (!conf->tuningProfile.empty() && !saveTuning(device, conf))
+		{
+			fprintf(stderr, "Process %d: %s %s\n", conf->mpiRank, CL_WARNING_TUNING_WRITE, conf->tuningProfile.c_str());
+		}
+	}
+
+	if (nTuned == 0)
+	{
+		fprintf(stdout, "Process %d: No OpenCL devices to tune\n", conf->mpiRank);
+	}
+}
+
 /**
  * @brief Gets the IDs of all available OpenCL devices
  * @return A vector containing the IDs of all devices
@@ -259,15 +727,19 @@ std::vector<cl_device_id> getAllDevices()
 		for (int i = 0; i < numPlatforms; ++i)
 		{
 
-			// Get the number of devices of this platform
-			status = clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_GPU, 0, 0, (cl_uint *)&numPlatformsDevices);
+			// Get the number of devices of this platform (GPUs and CPUs)
+			status = clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_GPU | CL_DEVICE_TYPE_CPU, 0, 0, (cl_uint *)&numPlatformsDevices);
 			check(status != CL_SUCCESS && status != CL_DEVICE_NOT_FOUND, "%s\n", CL_ERROR_DEVICES_NUMBER);
+			if (status == CL_DEVICE_NOT_FOUND)
+			{
+				numPlatformsDevices = 0;
+			}
 
 			// Get all devices of this platform
 			if (numPlatformsDevices > 0)
 			{
 				devices = new cl_device_id[numPlatformsDevices];
-				check(clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_GPU, numPlatformsDevices, devices, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_ID);
+				check(clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_GPU | CL_DEVICE_TYPE_CPU, numPlatformsDevices, devices, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_ID);
 				allDevices.insert(allDevices.end(), devices, devices + numPlatformsDevices);
 				delete[] devices;
 			}
@@ -295,10 +767,12 @@ void listDevices(const int mpiRank)
 		char nameBuff[128];
 		size_t maxWorkitems[3];
 		unsigned int maxCU;
+		cl_device_type deviceType;
 		check(clGetDeviceInfo(allDevices[i], CL_DEVICE_NAME, sizeof(nameBuff), nameBuff, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_NAME);
 		check(clGetDeviceInfo(allDevices[i], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &maxCU, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_MAXCU);
 		check(clGetDeviceInfo(allDevices[i], CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(size_t) * 3, maxWorkitems, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_MAXWORKITEMS);
-		devices += "\n\tDevice " + std::to_string(i) + " ->  Name: " + nameBuff + ";  Compute units: " + std::to_string(maxCU) + ";  Max Work-items: " + std::to_string(maxWorkitems[0]);
+		check(clGetDeviceInfo(allDevices[i], CL_DEVICE_TYPE, sizeof(cl_device_type), &deviceType, NULL) != CL_SUCCESS, "%s\n", CL_ERROR_DEVICE_TYPE);
+		devices += "\n\tDevice " + std::to_string(i) + " ->  Name: " + nameBuff + ";  Type: " + ((deviceType & CL_DEVICE_TYPE_CPU) ? "CPU" : "GPU") + ";  Compute units: " + std::to_string(maxCU) + ";  Max Work-items: " + std::to_string(maxWorkitems[0]);
 	}
 	fprintf(stdout, "%s\n", devices.c_str());
 }
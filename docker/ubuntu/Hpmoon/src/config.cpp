@@ -17,12 +17,14 @@
 
 /********************************* Includes *******************************/
 
+#include "bd.h"
 #include "clUtils.h"
 #include "cmdParser.h"
 #include "tinyxml2.h"
 #include <mpi.h>
 #include <omp.h>
 #include <sstream>		// stringstream...
+#include <time.h>		// time
 #include <log_config.h> // LOG_ENABLED
 
 using namespace tinyxml2;
@@ -64,6 +66,8 @@ Config::Config(const int argc, const char **argv)
 	parser.addExample("mpirun --bind-to none --map-by node --host localhost ./bin/hpmoon -conf \"config.xml\" -ns 2 -trdb \"db/TRdata.txt\"");
 	parser.addExample("mpirun --bind-to none --map-by node --host node0,localhost ./bin/hpmoon -conf \"config.xml\" -ss 480 -ngm 3 -trdb \"db/TRdata.txt\" -trnorm");
 	parser.addExample("mpirun --bind-to none --map-by node --host node0,node1 ./bin/hpmoon -conf \"config.xml\" -ts 4 -maxf 85 -plotimg \"imgPareto\"");
+	parser.addExample("./bin/hpmoon -conf \"config.xml\" -trdb \"db/TRdata.txt\" -trconv \"db/TRdata.bin\"");
+	parser.addExample("mpirun --bind-to none --map-by node --host localhost,node0 ./bin/hpmoon -conf \"config.xml\" -trdb \"db/TRdata.txt\" -autotune");
 
 	// Options
 	parser.addArg("-h", false, "Display usage instructions.");																													// Display help
@@ -80,9 +84,23 @@ Config::Config(const int argc, const char **argv)
 	parser.addArg("-trni", true, "Maximum number of instances to be taken from the training database.");																		// Maximum number of training instances
 	parser.addArg("-trdb", true, "Name of the file containing the training database.");																							// Training database
 	parser.addArg("-trnorm", false, "If the training database must be normalized or not.");																						// Normalization of the training database
+	parser.addArg("-trcache", false, "If a text training database must be cached in binary format (same name plus \'.bin\') to be memory-mapped in later runs.");				// Binary cache of the training database
+	parser.addArg("-trdist", true, "How the workers get the training database: \'local\' (each process reads the file), \'bcast\' (the master reads it and broadcasts it) or \'shared\' (as \'bcast\', but with a single copy per node)."); // Distribution of the training database
+	parser.addArg("-trconv", true, "Converts the training database to binary format, writes it to the given file and exits.");													// Training database conversion
 	parser.addArg("-ts", true, "Number of individuals competing in the tournament.");																							// Tournament size
 	parser.addArg("-ke", true, "Name of the file containing the kernels with the OpenCL code.");																				// Kernels
-	parser.addArg("-cth", true, "Number of CPU threads. Leave empty to use all available CPU threads. To run in a sequential mode, set this parameter and NDevices to \'0\'."); // CPU threads
+	parser.addArg("-kecache", true, "Directory where the compiled OpenCL programs are cached to skip the kernel compilation in later runs. Leave empty to always compile them from source."); // Binary cache of the kernels
+	parser.addArg("-tuneprof", true, "Name of the file containing the tuned work-groups and work-items of each OpenCL device. They replace the configured ones for the same device, driver and database dimensions."); // Tuning profile
+	parser.addArg("-autotune", false, "Tunes the work-groups and work-items of each OpenCL device on a synthetic population, writes the best values to the tuning profile and exits."); // Auto-tuning
+	parser.addArg("-cth", true, "Number of CPU threads. Leave empty to use all available CPU threads. To run in a sequential mode, set this parameter and NDevices to \'0\'.");	// CPU threads
+	parser.addArg("-fcs", true, "Maximum number of chromosomes stored in the fitness cache. Set it to \'0\' to disable the cache.");											// Fitness cache size
+	parser.addArg("-im", true, "Island model: \'sync\' (the master migrates between all subpopulations after each global migration) or \'async\' (each worker evolves its subpopulations continuously and exchanges emigrants with the neighbours). A single process always runs \'sync\'."); // Island model
+	parser.addArg("-topo", true, "Topology of the asynchronous island model: \'ring\', \'torus\' or \'random\'.");																// Topology
+	parser.addArg("-isa", true, "Instruction set of the CPU evaluation: \'auto\' (the best one supported by the CPU), \'scalar\', \'sse4.2\', \'avx2\' or \'avx512\'.");		// CPU instruction set
+	parser.addArg("-k", true, "Number of centroids (clusters) of K-means.");																									// Number of centroids
+	parser.addArg("-kmi", true, "Maximum number of iterations of K-means. It stops before if no instance changes its cluster.");												// Max. iterations of K-means
+	parser.addArg("-km", true, "Assignment step of the CPU K-means: \'brute\' (all distances) or \'elkan\' (triangle inequality bounds skip the centroids which cannot be the closest one). Both give the same clusters."); // K-means mode
+	parser.addArg("-seed", true, "Seed of the run. The same seed gives the same results regardless of the number of threads and MPI processes. Leave empty to use the current time."); // Seed
 
 	// Parse and check the missing arguments
 	check(!parser.parse(argv, argc), "%s\n", CFG_ERROR_PARSE_ARGUMENTS);
@@ -205,6 +223,31 @@ Config::Config(const int argc, const char **argv)
 		parent->FirstChildElement("Normalize")->QueryBoolText(&(this->trNormalize));
 	}
 
+	////////////////////// -trcache value
+	XMLElement *cacheElement = parent->FirstChildElement("Cache");
+	this->trCache = parser.isSet("-trcache");
+	if (!this->trCache && cacheElement != NULL)
+	{
+		cacheElement->QueryBoolText(&(this->trCache));
+	}
+
+	////////////////////// -trdist value
+	XMLElement *distElement = parent->FirstChildElement("Distribution");
+	std::string distribution = "local";
+	if (parser.isSet("-trdist"))
+	{
+		distribution = parser.getValue<char *>("-trdist");
+	}
+	else if (distElement != NULL && distElement->GetText() != NULL)
+	{
+		distribution = distElement->GetText();
+	}
+	this->trDistribution = (distribution == "local") ? TR_DIST_LOCAL : (distribution == "bcast") ? TR_DIST_BCAST : (distribution == "shared") ? TR_DIST_SHARED : -1;
+	check(this->trDistribution < 0, "%s\n", CFG_ERROR_DISTRIBUTION);
+
+	////////////////////// -trconv value
+	this->trConvFileName = (parser.isSet("-trconv")) ? parser.getValue<char *>("-trconv") : "";
+
 	////////////////////// -ts value
 	if (parser.isSet("-ts"))
 	{
@@ -216,6 +259,131 @@ Config::Config(const int argc, const char **argv)
 	}
 	check(this->tourSize < 2 || this->tourSize > this->subpopulationSize, "%s\n", CFG_ERROR_TOURNAMENT_SIZE);
 
+	////////////////////// -fcs value
+	if (parser.isSet("-fcs"))
+	{
+		this->fitnessCacheSize = parser.getValue<int>("-fcs");
+	}
+	else
+	{
+		XMLElement *aux = root->FirstChildElement("FitnessCacheSize");
+		this->fitnessCacheSize = 0;
+		if (aux != NULL)
+		{
+			aux->QueryIntText(&(this->fitnessCacheSize));
+		}
+	}
+	check(this->fitnessCacheSize < 0, "%s\n", CFG_ERROR_CACHE_SIZE);
+
+	////////////////////// -seed value
+	XMLElement *seedElement = root->FirstChildElement("Seed");
+	if (parser.isSet("-seed"))
+	{
+		this->seed = (unsigned int)parser.getValue<int>("-seed");
+	}
+	else if (seedElement != NULL && seedElement->GetText() != NULL)
+	{
+		seedElement->QueryUnsignedText(&(this->seed));
+	}
+	else
+	{
+
+		// All processes must share the seed, so the master chooses it
+		this->seed = (unsigned int)time(NULL);
+		MPI::COMM_WORLD.Bcast(&(this->seed), 1, MPI::UNSIGNED, 0);
+	}
+
+	////////////////////// -im value
+	XMLElement *modelElement = root->FirstChildElement("IslandModel");
+	std::string model = "sync";
+	if (parser.isSet("-im"))
+	{
+		model = parser.getValue<char *>("-im");
+	}
+	else if (modelElement != NULL && modelElement->GetText() != NULL)
+	{
+		model = modelElement->GetText();
+	}
+	this->islandModel = (model == "sync") ? ISLANDS_SYNC : (model == "async") ? ISLANDS_ASYNC : -1;
+	check(this->islandModel < 0, "%s\n", CFG_ERROR_ISLAND_MODEL);
+
+	////////////////////// -topo value
+	XMLElement *topologyElement = root->FirstChildElement("Topology");
+	std::string topology = "ring";
+	if (parser.isSet("-topo"))
+	{
+		topology = parser.getValue<char *>("-topo");
+	}
+	else if (topologyElement != NULL && topologyElement->GetText() != NULL)
+	{
+		topology = topologyElement->GetText();
+	}
+	this->topology = (topology == "ring") ? TOPOLOGY_RING : (topology == "torus") ? TOPOLOGY_TORUS : (topology == "random") ? TOPOLOGY_RANDOM : -1;
+	check(this->topology < 0, "%s\n", CFG_ERROR_TOPOLOGY);
+
+	////////////////////// -isa value
+	XMLElement *isaElement = root->FirstChildElement("CpuIsa");
+	std::string isa = "auto";
+	if (parser.isSet("-isa"))
+	{
+		isa = parser.getValue<char *>("-isa");
+	}
+	else if (isaElement != NULL && isaElement->GetText() != NULL)
+	{
+		isa = isaElement->GetText();
+	}
+	this->cpuIsa = (isa == "auto") ? ISA_AUTO : (isa == "scalar") ? ISA_SCALAR : (isa == "sse4.2") ? ISA_SSE42 : (isa == "avx2") ? ISA_AVX2 : (isa == "avx512") ? ISA_AVX512 : -1;
+	check(this->cpuIsa < 0, "%s\n", CFG_ERROR_ISA);
+
+	////////////////////// -km value
+	XMLElement *kmeansElement = root->FirstChildElement("KmeansMode");
+	std::string kmeans = "brute";
+	if (parser.isSet("-km"))
+	{
+		kmeans = parser.getValue<char *>("-km");
+	}
+	else if (kmeansElement != NULL && kmeansElement->GetText() != NULL)
+	{
+		kmeans = kmeansElement->GetText();
+	}
+	this->kmeansMode = (kmeans == "brute") ? KMEANS_BRUTE : (kmeans == "elkan") ? KMEANS_ELKAN : -1;
+	check(this->kmeansMode < 0, "%s\n", CFG_ERROR_KMEANS_MODE);
+
+	////////////////////// -k value (the mapping tables store the cluster of each instance in a byte)
+	if (parser.isSet("-k"))
+	{
+		this->K = parser.getValue<int>("-k");
+	}
+	else
+	{
+		XMLElement *aux = root->FirstChildElement("NCentroids");
+		this->K = 3;
+		if (aux != NULL)
+		{
+			aux->QueryIntText(&(this->K));
+		}
+	}
+	check(this->K < 2 || this->K > this->trNInstances || this->K > 255, "%s\n", CFG_ERROR_CENTROIDS);
+
+	////////////////////// -kmi value
+	if (parser.isSet("-kmi"))
+	{
+		this->maxIterKmeans = parser.getValue<int>("-kmi");
+	}
+	else
+	{
+		XMLElement *aux = root->FirstChildElement("MaxIterKmeans");
+		this->maxIterKmeans = 20;
+		if (aux != NULL)
+		{
+			aux->QueryIntText(&(this->maxIterKmeans));
+		}
+	}
+	check(this->maxIterKmeans < 1, "%s\n", CFG_ERROR_KMEANS_ITERATIONS);
+
+	////////////////////// -autotune value
+	this->tune = parser.isSet("-autotune");
+
 	if (rank > 0 || (rank == 0 && size == 1))
 	{
 
@@ -248,6 +416,28 @@ Config::Config(const int argc, const char **argv)
 
 			////////////////////// -ke value
 			this->kernelsFileName = (parser.isSet("-ke")) ? parser.getValue<char *>("-ke") : parent->NextSiblingElement("KernelsFileName")->GetText();
+
+			////////////////////// -kecache value
+			XMLElement *kernelsCacheElement = parent->NextSiblingElement("KernelsCacheDir");
+			if (parser.isSet("-kecache"))
+			{
+				this->kernelsCacheDir = parser.getValue<char *>("-kecache");
+			}
+			else if (kernelsCacheElement != NULL && kernelsCacheElement->GetText() != NULL)
+			{
+				this->kernelsCacheDir = kernelsCacheElement->GetText();
+			}
+
+			////////////////////// -tuneprof value
+			XMLElement *tuningElement = parent->NextSiblingElement("TuningProfile");
+			if (parser.isSet("-tuneprof"))
+			{
+				this->tuningProfile = parser.getValue<char *>("-tuneprof");
+			}
+			else if (tuningElement != NULL && tuningElement->GetText() != NULL)
+			{
+				this->tuningProfile = tuningElement->GetText();
+			}
 		}
 
 		////////////////////// CPU threads value
@@ -289,12 +479,6 @@ Config::Config(const int argc, const char **argv)
 
 	/************ Set and get the internal parameters ***********/
 
-	////////////////////// Number of centroids for K-means algorithm
-	this->K = 3;
-
-	////////////////////// Maximum iterations for K-means algorithm
-	this->maxIterKmeans = 20;
-
 	////////////////////// The size of the pool (the half of the subpopulation size)
 	this->poolSize = this->subpopulationSize >> 1;
 
@@ -307,9 +491,17 @@ Config::Config(const int argc, const char **argv)
 	////////////////////// Total number of individuals in the world (including parents and children)
 	this->totalIndividuals = this->worldSize << 1;
 
-	////////////////////// Number of features of the training database
-	this->nFeatures = N_FEATURES;
-	check(N_FEATURES < 4, "%s\n", CFG_ERROR_FEATURES_MIN);
+	////////////////////// Number of features of the training database. Only the master reads it
+	if (rank == 0)
+	{
+		this->nFeatures = getDataBaseColumns(this);
+	}
+	MPI::COMM_WORLD.Bcast(&(this->nFeatures), 1, MPI::INT, 0);
+	check(this->nFeatures < 4, "%s\n", CFG_ERROR_FEATURES_MIN);
+
+	////////////////////// Number of words of a chromosome and size of an individual
+	this->nWords = (this->nFeatures + 63) >> 6;
+	this->individualSize = sizeof(Individual) + this->nWords * sizeof(uint64_t);
 
 	////////////////////// Number of objectives
 	this->nObjectives = 2;
@@ -0,0 +1,325 @@
+/**
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE', which is part of Hpmoon repository.
+ *
+ * This work has been funded by:
+ *
+ * Spanish 'Ministerio de Economía y Competitividad' under grants number TIN2012-32039 and TIN2015-67020-P.\n
+ * Spanish 'Ministerio de Ciencia, Innovación y Universidades' under grant number PGC2018-098813-B-C31.\n
+ * European Regional Development Fund (ERDF).
+ *
+ * @file distances.cpp
+ * @author agent
+ * @date 17/10/2026
+ * @brief Implementation of the vectorized K-means distance kernels for CPU
+ * @copyright Hpmoon (c) 2015 EFFICOMP
+ */
+
+/********************************* Includes *******************************/
+
+#include "distances.h"
+#include <algorithm> // std::min
+
+// The vector kernels are compiled for their instruction set regardless of the compiler flags and selected at runtime
+#if defined(__x86_64__) || defined(__i386__)
+#define DS_X86 1
+#include <immintrin.h> // SSE, AVX2 and AVX-512 intrinsics
+#else
+#define DS_X86 0
+#endif
+
+/********************************* Defines ********************************/
+
+/**
+ * @brief Number of centroids which share each load of the instance in the vector kernels. With less than 4 centroids known
+ * at compile time, the group is not filled with repeated centroids
+ */
+#define DS_GROUP ((FIXED_K > 0 && FIXED_K < 4) ? FIXED_K : 4)
+
+/**
+ * @brief Table with the kernel of an instruction set for each number of centroids. Position 0 is the generic kernel
+ */
+#define DS_KERNELS(kernel) {kernel<0>, kernel<1>, kernel<2>, kernel<3>, kernel<4>, kernel<5>, kernel<6>, kernel<7>, kernel<8>}
+
+/********************************* Methods ********************************/
+
+/**
+ * @brief Scalar kernel. The features are added in order, as in the rest of the application
+ * @tparam FIXED_K The number of centroids known at compile time (0 if it is only known at runtime)
+ * @param instance The selected features of the instance
+ * @param centroids The centroids, one after another
+ * @param K The number of centroids
+ * @param nSel The number of selected features
+ * @param distances Where the K distances are stored
+ */
+template <int FIXED_K>
+static void distancesScalar(const float *const instance, const float *const centroids, const int K, const int nSel, float *const distances)
+{
+
+	const int nK = (FIXED_K > 0) ? FIXED_K : K;
+	for (int k = 0; k < nK; ++k)
+	{
+		const float *const centroid = centroids + (k * nSel);
+		float dist = 0.0f;
+		for (int j = 0; j < nSel; ++j)
+		{
+			float dif = instance[j] - centroid[j];
+			dist += dif * dif;
+		}
+		distances[k] = dist;
+	}
+}
+
+#if DS_X86
+
+/**
+ * @brief SSE4.2 kernel. Groups of up to 4 centroids share each load of the instance. The last features are added one by one
+ * @tparam FIXED_K The number of centroids known at compile time (0 if it is only known at runtime)
+ * @param instance The selected features of the instance
+ * @param centroids The centroids, one after another
+ * @param K The number of centroids
+ * @param nSel The number of selected features
+ * @param distances Where the K distances are stored
+ */
+template <int FIXED_K>
+__attribute__((target("sse4.2"))) static void distancesSSE42(const float *const instance, const float *const centroids, const int K, const int nSel, float *const distances)
+{
+
+	const int nVec = nSel & ~3;
+	const int nK = (FIXED_K > 0) ? FIXED_K : K;
+	for (int k = 0; k < nK; k += DS_GROUP)
+	{
+
+		// Incomplete groups repeat the last centroid and discard its results
+		const int nGroup = std::min(DS_GROUP, nK - k);
+		const float *c[4];
+		for (int g = 0; g < DS_GROUP; ++g)
+		{
+			c[g] = centroids + ((k + std::min(g, nGroup - 1)) * nSel);
+		}
+
+		__m128 acc[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+		for (int j = 0; j < nVec; j += 4)
+		{
+			__m128 x = _mm_loadu_ps(instance + j);
+			for (int g = 0; g < DS_GROUP; ++g)
+			{
+				__m128 dif = _mm_sub_ps(x, _mm_loadu_ps(c[g] + j));
+				acc[g] = _mm_add_ps(acc[g], _mm_mul_ps(dif, dif));
+			}
+		}
+
+		for (int g = 0; g < nGroup; ++g)
+		{
+			__m128 sum = _mm_hadd_ps(acc[g], acc[g]);
+			float dist = _mm_cvtss_f32(_mm_hadd_ps(sum, sum));
+			for (int j = nVec; j < nSel; ++j)
+			{
+				float dif = instance[j] - c[g][j];
+				dist += dif * dif;
+			}
+			distances[k + g] = dist;
+		}
+	}
+}
+
+/**
+ * @brief AVX2 kernel. Groups of up to 4 centroids share each load of the instance. The last features are loaded with a mask
+ * @tparam FIXED_K The number of centroids known at compile time (0 if it is only known at runtime)
+ * @param instance The selected features of the instance
+ * @param centroids The centroids, one after another
+ * @param K The number of centroids
+ * @param nSel The number of selected features
+ * @param distances Where the K distances are stored
+ */
+template <int FIXED_K>
+__attribute__((target("avx2,fma"))) static void distancesAVX2(const float *const instance, const float *const centroids, const int K, const int nSel, float *const distances)
+{
+
+	const int nVec = nSel & ~7;
+	const __m256i tailMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(nSel - nVec), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	const int nK = (FIXED_K > 0) ? FIXED_K : K;
+	for (int k = 0; k < nK; k += DS_GROUP)
+	{
+
+		// Incomplete groups repeat the last centroid and discard its results
+		const int nGroup = std::min(DS_GROUP, nK - k);
+		const float *c[4];
+		for (int g = 0; g < DS_GROUP; ++g)
+		{
+			c[g] = centroids + ((k + std::min(g, nGroup - 1)) * nSel);
+		}
+
+		__m256 acc[4] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+		for (int j = 0; j < nVec; j += 8)
+		{
+			__m256 x = _mm256_loadu_ps(instance + j);
+			for (int g = 0; g < DS_GROUP; ++g)
+			{
+				__m256 dif = _mm256_sub_ps(x, _mm256_loadu_ps(c[g] + j));
+				acc[g] = _mm256_fmadd_ps(dif, dif, acc[g]);
+			}
+		}
+
+		// The masked lanes are loaded as 0, so they do not contribute
+		if (nVec < nSel)
+		{
+			__m256 x = _mm256_maskload_ps(instance + nVec, tailMask);
+			for (int g = 0; g < DS_GROUP; ++g)
+			{
+				__m256 dif = _mm256_sub_ps(x, _mm256_maskload_ps(c[g] + nVec, tailMask));
+				acc[g] = _mm256_fmadd_ps(dif, dif, acc[g]);
+			}
+		}
+
+		for (int g = 0; g < nGroup; ++g)
+		{
+			__m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc[g]), _mm256_extractf128_ps(acc[g], 1));
+			sum = _mm_hadd_ps(sum, sum);
+			distances[k + g] = _mm_cvtss_f32(_mm_hadd_ps(sum, sum));
+		}
+	}
+}
+
+/**
+ * @brief AVX-512 kernel. Groups of up to 4 centroids share each load of the instance. The last features are loaded with a mask
+ * @tparam FIXED_K The number of centroids known at compile time (0 if it is only known at runtime)
+ * @param instance The selected features of the instance
+ * @param centroids The centroids, one after another
+ * @param K The number of centroids
+ * @param nSel The number of selected features
+ * @param distances Where the K distances are stored
+ */
+template <int FIXED_K>
+__attribute__((target("avx512f"))) static void distancesAVX512(const float *const instance, const float *const centroids, const int K, const int nSel, float *const distances)
+{
+
+	const int nVec = nSel & ~15;
+	const __mmask16 tailMask = (__mmask16)((1u << (nSel - nVec)) - 1);
+	const int nK = (FIXED_K > 0) ? FIXED_K : K;
+	for (int k = 0; k < nK; k += DS_GROUP)
+	{
+
+		// Incomplete groups repeat the last centroid and discard its results
+		const int nGroup = std::min(DS_GROUP, nK - k);
+		const float *c[4];
+		for (int g = 0; g < DS_GROUP; ++g)
+		{
+			c[g] = centroids + ((k + std::min(g, nGroup - 1)) * nSel);
+		}
+
+		__m512 acc[4] = {_mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps()};
+		for (int j = 0; j < nVec; j += 16)
+		{
+			__m512 x = _mm512_loadu_ps(instance + j);
+			for (int g = 0; g < DS_GROUP; ++g)
+			{
+				__m512 dif = _mm512_sub_ps(x, _mm512_loadu_ps(c[g] + j));
+				acc[g] = _mm512_fmadd_ps(dif, dif, acc[g]);
+			}
+		}
+
+		// The masked lanes are loaded as 0, so they do not contribute
+		if (nVec < nSel)
+		{
+			__m512 x = _mm512_maskz_loadu_ps(tailMask, instance + nVec);
+			for (int g = 0; g < DS_GROUP; ++g)
+			{
+				__m512 dif = _mm512_sub_ps(x, _mm512_maskz_loadu_ps(tailMask, c[g] + nVec));
+				acc[g] = _mm512_fmadd_ps(dif, dif, acc[g]);
+			}
+		}
+
+		// The lanes are added through memory ('_mm512_reduce_add_ps' triggers false warnings of uninitialized values in GCC)
+		for (int g = 0; g < nGroup; ++g)
+		{
+			float lanes[16];
+			_mm512_storeu_ps(lanes, acc[g]);
+			for (int l = 8; l > 0; l >>= 1)
+			{
+				for (int i = 0; i < l; ++i)
+				{
+					lanes[i] += lanes[i + l];
+				}
+			}
+			distances[k + g] = lanes[0];
+		}
+	}
+}
+
+#endif
+
+/**
+ * @brief Kernels of each instruction set, specialized for 1 to DS_MAX_FIXED_K centroids
+ */
+static const DistancesKernel scalarKernels[DS_MAX_FIXED_K + 1] = DS_KERNELS(distancesScalar);
+#if DS_X86
+static const DistancesKernel sse42Kernels[DS_MAX_FIXED_K + 1] = DS_KERNELS(distancesSSE42);
+static const DistancesKernel avx2Kernels[DS_MAX_FIXED_K + 1] = DS_KERNELS(distancesAVX2);
+static const DistancesKernel avx512Kernels[DS_MAX_FIXED_K + 1] = DS_KERNELS(distancesAVX512);
+#endif
+
+/**
+ * @brief Selects the distance kernel for the instruction set of the configuration. With ISA_AUTO, the best one supported by the CPU is used
+ * @param K The number of centroids of each call to the kernel. The kernels specialized for it are preferred
+ * @param conf The structure with all configuration parameters
+ * @return The distance kernel
+ */
+DistancesKernel selectDistancesKernel(const int K, const Config *const conf)
+{
+
+	const int fixedK = (K <= DS_MAX_FIXED_K) ? K : 0;
+#if DS_X86
+	__builtin_cpu_init();
+	bool sse42 = __builtin_cpu_supports("sse4.2");
+	bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	bool avx512 = __builtin_cpu_supports("avx512f");
+	switch (conf->cpuIsa)
+	{
+	case ISA_AUTO:
+		return ((avx512) ? avx512Kernels : (avx2) ? avx2Kernels : (sse42) ? sse42Kernels : scalarKernels)[fixedK];
+	case ISA_SSE42:
+		check(!sse42, "%s\n", DS_ERROR_ISA_UNSUPPORTED);
+		return sse42Kernels[fixedK];
+	case ISA_AVX2:
+		check(!avx2, "%s\n", DS_ERROR_ISA_UNSUPPORTED);
+		return avx2Kernels[fixedK];
+	case ISA_AVX512:
+		check(!avx512, "%s\n", DS_ERROR_ISA_UNSUPPORTED);
+		return avx512Kernels[fixedK];
+	default:
+		return scalarKernels[fixedK];
+	}
+#else
+	check(conf->cpuIsa != ISA_AUTO && conf->cpuIsa != ISA_SCALAR, "%s\n", DS_ERROR_ISA_UNSUPPORTED);
+	return scalarKernels[fixedK];
+#endif
+}
+
+/**
+ * @brief Gets the name of the instruction set of a distance kernel
+ * @param kernel The distance kernel
+ * @return The name of the instruction set
+ */
+const char *getDistancesKernelName(const DistancesKernel kernel)
+{
+
+#if DS_X86
+	for (int k = 0; k <= DS_MAX_FIXED_K; ++k)
+	{
+		if (kernel == sse42Kernels[k])
+		{
+			return "sse4.2";
+		}
+		if (kernel == avx2Kernels[k])
+		{
+			return "avx2";
+		}
+		if (kernel == avx512Kernels[k])
+		{
+			return "avx512";
+		}
+	}
+#endif
+	return "scalar";
+}
@@ -15,64 +15,21 @@
  * @copyright Hpmoon (c) 2015 EFFICOMP
  */
 
-/*********************************** Defines *********************************/
-
-/**
- * @brief Structure containing the Individual's parameters
- */
-typedef struct Individual {
-
-
-	/**
-	 * @brief Vector denoting the selected features
-	 *
-	 * Values: Zeros or ones
-	 */
-	unsigned char chromosome[N_FEATURES];
-
-
-	/**
-	 * @brief Individual fitness for the multi-objective functions
-	 *
-	 * Values: Each position contains an objective function
-	 */
-	float fitness[N_OBJECTIVES];
-
-
-	/**
-	 * @brief Crowding distance of the individual
-	 *
-	 * The values are positives or infinites
-	 */
-	float crowding;
-
-
-	/**
-	 * @brief Range of the individual (Pareto front)
-	 */
-	int rank;
-
-
-	/**
-	 * @brief Number of selected features
-	 */
-	int nSelFeatures;
-
-} Individual;
-
 /********************************* OpenCL Kernels ********************************/
 
 
 /**
  * @brief Computes the K-means algorithm in a OpenCL GPU device
- * @param subpop OpenCL object which contains the current subpopulation. The object is stored in global memory
+ * @param chromosomes OpenCL object which contains the chromosomes of the current subpopulation, 'N_WORDS' words per individual. The object is stored in global memory
  * @param selInstances OpenCL object which contains the instances choosen as initial centroids. The object is stored in constant memory
  * @param trDataBase OpenCL object which contains the training database. The object is stored in global memory
  * @param begin The first individual to be evaluated
  * @param end The 'end-1' position is the last individual to be evaluated
  * @param transposedDataBase OpenCL object which contains the transposed training database. The object is stored in global memory
+ * @param iterations OpenCL object which will contain the number of iterations executed by K-means for each individual. The object is stored in global memory
+ * @param fitness OpenCL object which will contain the fitness of each individual, 'N_OBJECTIVES' values per individual. The object is stored in global memory
  */
-__kernel void kmeansGPU(__global struct Individual *subpop, __constant int *restrict selInstances, __global float *restrict trDataBase, const int begin, const int end, __global float *restrict transposedDataBase) {
+__kernel void kmeansGPU(__global const ulong *restrict chromosomes, __constant int *restrict selInstances, __global float *restrict trDataBase, const int begin, const int end, __global float *restrict transposedDataBase, __global int *restrict iterations, __global float *restrict fitness) {
 
 	uint localId = get_local_id(0);
 	uint localSize = get_local_size(0);
@@ -82,11 +39,12 @@ __kernel void kmeansGPU(__global struct Individual *subpop, __constant int *rest
 	const int totalCoord = K * N_FEATURES;
 
 	// The individual is cached into local memory to improve performance
-	__local uchar chromosome[N_FEATURES];
+	__local ulong chromosome[N_WORDS];
 	__local uchar mapping[N_INSTANCES];
 	__local float centroids_l[K * N_FEATURES];
 	__local float distCentroids[N_INSTANCES];
 	__local int samples_in_k[K];
+	__local int changed;
 
 	event_t eventInd;
 	event_t eventCentr;
@@ -101,15 +59,13 @@ __kernel void kmeansGPU(__global struct Individual *subpop, __constant int *rest
 		}
 
 		// The individual is cached to local memory for improve performance
-		eventInd = async_work_group_copy(chromosome, subpop[ind].chromosome, N_FEATURES, 0);
+		eventInd = async_work_group_copy(chromosome, chromosomes + (ind * N_WORDS), N_WORDS, 0);
 
 		// Initialize the mapping table
 		for (int i = localId; i < N_INSTANCES; i += localSize) {
 			mapping[i] = 0;
 		}
 
-		//converged = false;
-
 		// Syncpoint
 		wait_group_events(1, &eventInd);
 		wait_group_events(1, &eventCentr);
@@ -117,14 +73,18 @@ __kernel void kmeansGPU(__global struct Individual *subpop, __constant int *rest
 
 		/******************** Convergence process *********************/
 
-		// To avoid poor performance, 'MAX_ITER_KMEANS' iterations are executed
-		for (int maxIter = 0; maxIter < MAX_ITER_KMEANS/* && !converged*/; ++maxIter) {
+		// To avoid poor performance, at most 'MAX_ITER_KMEANS' iterations are executed
+		int nIterations = MAX_ITER_KMEANS;
+		for (int maxIter = 0; maxIter < MAX_ITER_KMEANS; ++maxIter) {
 
 			barrier(CLK_LOCAL_MEM_FENCE);
 
 			for (int k = localId; k < K; k += localSize) {
 				samples_in_k[k] = 0;
 			}
+			if (localId == 0) {
+				changed = 0;
+			}
 
 			// Syncpoint
 			barrier(CLK_LOCAL_MEM_FENCE);
@@ -132,11 +92,14 @@ __kernel void kmeansGPU(__global struct Individual *subpop, __constant int *rest
 			// Calculate all distances (Euclidean distance) between each instance and the centroids
 			for (int i = localId; i < N_INSTANCES; i += localSize) {
 				float minDist = INFINITY;
-				int selectCentroid;
+				int selectCentroid = mapping[i];
 				for (int k = 0, posCentr = 0; k < K; ++k, posCentr += N_FEATURES) {
 					float dist = 0.0f;
-					for (int f = 0; f < N_FEATURES; ++f) {
-						if (chromosome[f]) {
+
+					// Only the selected features are visited (bit iteration over the chromosome words)
+					for (int w = 0; w < N_WORDS; ++w) {
+						for (ulong bits = chromosome[w]; bits; bits &= bits - 1) {
+							int f = (w << 6) + (int)(63 - clz(bits & (~bits + 1)));
 							float dif = transposedDataBase[(N_INSTANCES * f) + i] - centroids_l[posCentr + f];
 							dist = mad(dif, dif, dist);
 						}
@@ -153,17 +116,24 @@ __kernel void kmeansGPU(__global struct Individual *subpop, __constant int *rest
 
 				if (mapping[i] != selectCentroid) {
 					mapping[i] = selectCentroid;
+					changed = 1;
 				}
 			}
 
 			// Syncpoint
 			barrier(CLK_LOCAL_MEM_FENCE);
 
+			// If no instance has changed its cluster, the centroids would not change anymore. All the work-items leave the loop
+			if (!changed && maxIter > 0) {
+				nIterations = maxIter + 1;
+				break;
+			}
+
 			// Update the position of the centroids
 			for (int kf = localId; kf < totalCoord; kf += localSize) {
 				int k = kf / N_FEATURES;
 				int f = kf - (k * N_FEATURES); // kf % N_FEATURES
-				if (chromosome[f] && samples_in_k[k] > 0) {
+				if (((chromosome[f >> 6] >> (f & 63)) & 1) && samples_in_k[k] > 0) {
 					float sum = 0.0f;
 					for (int i = 0; i < N_INSTANCES; ++i) {
 						sum += (mapping[i] == k) ? trDataBase[(N_FEATURES * i) + f] : 0;
@@ -192,8 +162,9 @@ __kernel void kmeansGPU(__global struct Individual *subpop, __constant int *rest
 			for (int posCentr = 0; posCentr < totalCoord; posCentr += N_FEATURES) {
 				for (int i = posCentr + N_FEATURES; i < totalCoord; i += N_FEATURES) {
 					float sum = 0.0f;
-					for (int f = 0; f < N_FEATURES; ++f) {
-						if (chromosome[f]) {
+					for (int w = 0; w < N_WORDS; ++w) {
+						for (ulong bits = chromosome[w]; bits; bits &= bits - 1) {
+							int f = (w << 6) + (int)(63 - clz(bits & (~bits + 1)));
 							sum += (centroids_l[posCentr + f] - centroids_l[i + f]) * (centroids_l[posCentr + f] - centroids_l[i + f]);
 						}
 					}
@@ -202,13 +173,192 @@ __kernel void kmeansGPU(__global struct Individual *subpop, __constant int *rest
 			}
 
 			// First objective function (Within-cluster sum of squares (WCSS))
-			subpop[ind].fitness[0] = sumWithin;//printf("IND %d\n", ind);printf("%f\n", sumWithin);
+			fitness[ind * N_OBJECTIVES] = sumWithin;//printf("IND %d\n", ind);printf("%f\n", sumWithin);
 
 			// Second objective function (Inter-cluster sum of squares (ICSS))
-			subpop[ind].fitness[1] = sumInter;//printf("%f\n", sumInter);
+			fitness[(ind * N_OBJECTIVES) + 1] = sumInter;//printf("%f\n", sumInter);
+
+			iterations[ind] = nIterations;
 		}
 
 		// Syncpoint
 		barrier(CLK_LOCAL_MEM_FENCE);
 	}
 }
+
+
+/**
+ * @brief Computes the K-means algorithm in a OpenCL CPU device
+ *
+ * Each work-group has a single work-item which computes a whole individual, so no barriers nor local memory are needed.
+ * The selected features are compacted once per individual and the distances are computed over 4 instances at once from the transposed database
+ * @param chromosomes OpenCL object which contains the chromosomes of the current subpopulation, 'N_WORDS' words per individual. The object is stored in global memory
+ * @param selInstances OpenCL object which contains the instances choosen as initial centroids. The object is stored in constant memory
+ * @param trDataBase OpenCL object which contains the training database. The object is stored in global memory
+ * @param begin The first individual to be evaluated
+ * @param end The 'end-1' position is the last individual to be evaluated
+ * @param transposedDataBase OpenCL object which contains the transposed training database. The object is stored in global memory
+ * @param iterations OpenCL object which will contain the number of iterations executed by K-means for each individual. The object is stored in global memory
+ * @param fitness OpenCL object which will contain the fitness of each individual, 'N_OBJECTIVES' values per individual. The object is stored in global memory
+ */
+__kernel __attribute__((reqd_work_group_size(1, 1, 1))) void kmeansCPU(__global const ulong *restrict chromosomes, __constant int *restrict selInstances, __global float *restrict trDataBase, const int begin, const int end, __global float *restrict transposedDataBase, __global int *restrict iterations, __global float *restrict fitness) {
+
+	uint groupId = get_group_id(0);
+	uint numGroups = get_num_groups(0);
+
+	// The buffers are private to the work-item (the stack of the CPU thread)
+	int selFeatures[N_FEATURES];
+	uchar mapping[N_INSTANCES];
+	float centroids[K * N_FEATURES];
+	float distCentroids[N_INSTANCES];
+	int samples_in_k[K];
+
+	// Each work-group compute an individual (master-slave as a deck algorithm)
+	for (int ind = begin + groupId; ind < end; ind += numGroups) {
+
+		// Compact the selected features of the individual
+		int nSelFeatures = 0;
+		for (int w = 0; w < N_WORDS; ++w) {
+			for (ulong bits = chromosomes[(ind * N_WORDS) + w]; bits; bits &= bits - 1) {
+				selFeatures[nSelFeatures++] = (w << 6) + (int)(63 - clz(bits & (~bits + 1)));
+			}
+		}
+
+		// The centroids will have the selected features of the individual, stored compacted ('nSelFeatures' per centroid)
+		for (int k = 0; k < K; ++k) {
+			for (int j = 0; j < nSelFeatures; ++j) {
+				centroids[(nSelFeatures * k) + j] = trDataBase[(selInstances[k] * N_FEATURES) + selFeatures[j]];
+			}
+		}
+
+		// Initialize the mapping table
+		for (int i = 0; i < N_INSTANCES; ++i) {
+			mapping[i] = 0;
+		}
+
+
+		/******************** Convergence process *********************/
+
+		// To avoid poor performance, at most 'MAX_ITER_KMEANS' iterations are executed
+		int nIterations = MAX_ITER_KMEANS;
+		for (int maxIter = 0; maxIter < MAX_ITER_KMEANS; ++maxIter) {
+
+			for (int k = 0; k < K; ++k) {
+				samples_in_k[k] = 0;
+			}
+			bool changed = false;
+
+			// Calculate all distances (Euclidean distance) between each instance and the centroids. 4 instances at once
+			int i = 0;
+			for (; i + 4 <= N_INSTANCES; i += 4) {
+				float4 minDist = (float4)(INFINITY);
+				int4 selectCentroid = (int4)(0);
+				for (int k = 0; k < K; ++k) {
+					float4 dist = (float4)(0.0f);
+					for (int j = 0; j < nSelFeatures; ++j) {
+						float4 dif = vload4(0, transposedDataBase + (N_INSTANCES * selFeatures[j]) + i) - (float4)(centroids[(nSelFeatures * k) + j]);
+						dist = mad(dif, dif, dist);
+					}
+
+					int4 closer = isless(dist, minDist);
+					minDist = select(minDist, dist, closer);
+					selectCentroid = select(selectCentroid, (int4)(k), closer);
+				}
+
+				vstore4(minDist, 0, distCentroids + i);
+				int nearest[4] = {selectCentroid.s0, selectCentroid.s1, selectCentroid.s2, selectCentroid.s3};
+				for (int l = 0; l < 4; ++l) {
+					++samples_in_k[nearest[l]];
+					if (mapping[i + l] != nearest[l]) {
+						mapping[i + l] = nearest[l];
+						changed = true;
+					}
+				}
+			}
+
+			// Remaining instances
+			for (; i < N_INSTANCES; ++i) {
+				float minDist = INFINITY;
+				int selectCentroid = 0;
+				for (int k = 0; k < K; ++k) {
+					float dist = 0.0f;
+					for (int j = 0; j < nSelFeatures; ++j) {
+						float dif = transposedDataBase[(N_INSTANCES * selFeatures[j]) + i] - centroids[(nSelFeatures * k) + j];
+						dist = mad(dif, dif, dist);
+					}
+
+					if (dist < minDist) {
+						minDist = dist;
+						selectCentroid = k;
+					}
+				}
+
+				distCentroids[i] = minDist;
+				++samples_in_k[selectCentroid];
+				if (mapping[i] != selectCentroid) {
+					mapping[i] = selectCentroid;
+					changed = true;
+				}
+			}
+
+			// If no instance has changed its cluster, the centroids would not change anymore
+			if (!changed && maxIter > 0) {
+				nIterations = maxIter + 1;
+				break;
+			}
+
+			// Update the position of the centroids. Empty clusters keep their centroid
+			for (int k = 0; k < K; ++k) {
+				if (samples_in_k[k] > 0) {
+					for (int j = 0; j < nSelFeatures; ++j) {
+						centroids[(nSelFeatures * k) + j] = 0.0f;
+					}
+				}
+			}
+			for (int i = 0; i < N_INSTANCES; ++i) {
+				int posCentr = nSelFeatures * mapping[i];
+				for (int j = 0; j < nSelFeatures; ++j) {
+					centroids[posCentr + j] += trDataBase[(N_FEATURES * i) + selFeatures[j]];
+				}
+			}
+			for (int k = 0; k < K; ++k) {
+				if (samples_in_k[k] > 0) {
+					for (int j = 0; j < nSelFeatures; ++j) {
+						centroids[(nSelFeatures * k) + j] /= samples_in_k[k];
+					}
+				}
+			}
+		}
+
+
+		/************ Minimize the within-cluster and maximize Inter-cluster sum of squares (WCSS and ICSS) *************/
+
+		float sumWithin = 0.0f;
+		float sumInter = 0.0f;
+
+		// Within-cluster
+		for (int i = 0; i < N_INSTANCES; ++i) {
+			sumWithin += sqrt(distCentroids[i]);
+		}
+
+		// Inter-cluster
+		for (int k = 0; k < K; ++k) {
+			for (int l = k + 1; l < K; ++l) {
+				float sum = 0.0f;
+				for (int j = 0; j < nSelFeatures; ++j) {
+					float dif = centroids[(nSelFeatures * k) + j] - centroids[(nSelFeatures * l) + j];
+					sum += dif * dif;
+				}
+				sumInter += sqrt(sum);
+			}
+		}
+
+		// First objective function (Within-cluster sum of squares (WCSS))
+		fitness[ind * N_OBJECTIVES] = sumWithin;
+
+		// Second objective function (Inter-cluster sum of squares (ICSS))
+		fitness[(ind * N_OBJECTIVES) + 1] = sumInter;
+
+		iterations[ind] = nIterations;
+	}
+}
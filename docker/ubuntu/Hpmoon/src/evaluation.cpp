@@ -18,48 +18,156 @@
 /********************************** Includes **********************************/
 
 #include "evaluation.h"
+#include "distances.h"
+#include "random.h"
 #include "zitzler.h"
-#include <omp.h>  // OpenMP
-#include <math.h> // exp, sqrt, INFINITY
+#include <omp.h>		// OpenMP
+#include <math.h>		// exp, sqrt, ceil, INFINITY
+#include <float.h>		// FLT_EPSILON
+#include <algorithm>	// std::max
 #include <iostream>
+#include <vector>		// std::vector
 #include <log_config.h> // LOG_ENABLED
 
+/********************************* Globals ********************************/
+
+/**
+ * @brief Histogram of the K-means runs of this process. Position 'i' counts the runs which stopped after 'i' iterations
+ */
+static std::vector<long int> kmeansIterations;
+
 /********************************* Methods ********************************/
 
 /**
- * @brief Evaluation of each individual in CPU in Sequential mode or using OpenMP
+ * @brief Adds a partial histogram of iterations to the one of the process
+ * @param iterations Position 'i' contains the number of K-means runs which stopped after 'i' iterations
+ * @param conf The structure with all configuration parameters
+ */
+static void addKmeansIterations(const long int *const iterations, const Config *const conf)
+{
+
+#pragma omp critical(kmeansIterations)
+	{
+		if (kmeansIterations.empty())
+		{
+			kmeansIterations.assign(conf->maxIterKmeans + 1, 0);
+		}
+		for (int i = 0; i <= conf->maxIterKmeans; ++i)
+		{
+			kmeansIterations[i] += iterations[i];
+		}
+	}
+}
+
+/**
+ * @brief K-means of each individual in CPU, in Sequential mode or using OpenMP
+ * @tparam FIXED_K The number of centroids known at compile time, so the loops over them are unrolled (0 if it is only known at runtime)
  * @param subpop The first individual to evaluate of the current subpopulation
  * @param nIndividuals The number of individuals which will be evaluated
  * @param trDataBase The training database which will contain the instances and the features
  * @param selInstances The instances choosen as initial centroids
  * @param nThreads The number of threads to perform the individuals evaluation
+ * @param arena The scratch arena where the buffers of the threads are stored
+ * @param distances The distance kernel for all centroids
+ * @param distance The distance kernel for a single centroid
  * @param conf The structure with all configuration parameters
  */
-void evaluationCPU(Individual *const subpop, const int nIndividuals, const float *const trDataBase, const int *const selInstances, const int nThreads, const Config *const conf)
+template <int FIXED_K>
+static void kmeansCPU(const Subpopulation subpop, const int nIndividuals, const float *const trDataBase, const int *const selInstances, const int nThreads, ScratchArena *const arena, const DistancesKernel distances, const DistancesKernel distance, const Config *const conf)
 {
 
+	const int K = (FIXED_K > 0) ? FIXED_K : conf->K;
+
+	// The gathered database is sized for the individual with more selected features
+	int maxSelFeatures = 1;
+	for (int ind = 0; ind < nIndividuals; ++ind)
+	{
+		maxSelFeatures = std::max(maxSelFeatures, subpop.nSelFeatures[ind]);
+	}
+
+	// The buffers of all threads are taken from the arena before the parallel region, since it is not thread-safe
+	const size_t mark = arena->mark();
+	float *const centroidsAll = arena->allocate<float>((size_t)nThreads * K * maxSelFeatures);
+	float *const sumsAll = arena->allocate<float>((size_t)nThreads * K * maxSelFeatures);
+	float *const subDataBaseAll = arena->allocate<float>((size_t)nThreads * conf->trNInstances * maxSelFeatures);
+	double *const lowerAll = arena->allocate<double>((size_t)nThreads * conf->trNInstances * K);
+	double *const halfPairsAll = arena->allocate<double>((size_t)nThreads * K * K);
+	float *const oldCentroidsAll = arena->allocate<float>((size_t)nThreads * K * maxSelFeatures);
+
 #pragma omp parallel num_threads(nThreads) if (nThreads > 1)
 	{
-		const int totalCoord = conf->K * conf->nFeatures;
+		const size_t thread = omp_get_thread_num();
 		unsigned char mapping[conf->trNInstances];
-		float centroids[totalCoord];
 		float distCentroids[conf->trNInstances];
-		int samples_in_k[conf->K];
-
-		int threadID = omp_get_thread_num();
+		int samples_in_k[K];
+		float dist[K];
+
+		// Compacted indexes of the selected features and dense copy of the database restricted to them
+		int selFeatures[conf->nFeatures];
+		float *centroids = centroidsAll + thread * K * maxSelFeatures;
+		float *sums = sumsAll + thread * K * maxSelFeatures;
+		float *subDataBase = subDataBaseAll + thread * conf->trNInstances * maxSelFeatures;
+
+		// Bounds of the Elkan's mode: distance from each instance to its centroid (upper) and to every centroid (lower),
+		// half of the distances between centroids and instances whose distance was not computed in the last iteration
+		double upper[conf->trNInstances];
+		double *lower = lowerAll + thread * conf->trNInstances * K;
+		double *halfPairs = halfPairsAll + thread * K * K;
+		bool visit[K];
+		bool stale[conf->trNInstances];
+		double half[K];
+		double drift[K];
+		float *oldCentroids = oldCentroidsAll + thread * K * maxSelFeatures;
+
+		// Iterations executed by the K-means runs of this thread
+		long int iterations[conf->maxIterKmeans + 1];
+		for (int i = 0; i <= conf->maxIterKmeans; ++i)
+		{
+			iterations[i] = 0;
+		}
 
 #pragma omp for
 		for (int ind = 0; ind < nIndividuals; ++ind)
 		{
+
+			// Get the selected features (bit iteration over the chromosome words)
+			const uint64_t *const chromosome = subpop.chromosome(ind);
+			int nSel = 0;
+			for (int w = 0; w < conf->nWords; ++w)
+			{
+				for (uint64_t bits = chromosome[w]; bits; bits &= bits - 1)
+				{
+					selFeatures[nSel++] = (w << 6) + __builtin_ctzll(bits);
+				}
+			}
+			const int totalCoord = K * nSel;
+
+			// Relative rounding error of the squared distances with 'nSel' features (with room to spare). The bounds
+			// are widened by it, so they also hold for the distances computed by the kernels
+			const double margin = (nSel + 4) * (double)FLT_EPSILON;
+			const double grow = 1.0 + margin;
+			const double shrink = 1.0 - margin;
+
+			// Gather the columns of the selected features. From here on, the cost only depends on 'nSel'
+			for (int i = 0; i < conf->trNInstances; ++i)
+			{
+				const float *const row = trDataBase + (conf->nFeatures * i);
+				float *const subRow = subDataBase + (nSel * i);
+				for (int j = 0; j < nSel; ++j)
+				{
+					subRow[j] = row[selFeatures[j]];
+				}
+			}
+
 			// The centroids will have the selected features of the individual
-			for (int k = 0; k < conf->K; ++k)
+			for (int k = 0; k < K; ++k)
 			{
-				int posTrDataBase = selInstances[k] * conf->nFeatures;
-				int posCentr = k * conf->nFeatures;
+				int posSubDataBase = selInstances[k] * nSel;
+				int posCentr = k * nSel;
 
-				for (int f = 0; f < conf->nFeatures; ++f)
+				for (int j = 0; j < nSel; ++j)
 				{
-					centroids[posCentr + f] = trDataBase[posTrDataBase + f];
+					centroids[posCentr + j] = subDataBase[posSubDataBase + j];
 				}
 			}
 
@@ -70,63 +178,214 @@ void evaluationCPU(Individual *const subpop, const int nIndividuals, const float
 			}
 
 			// Convergence process
+			const bool bounded = (conf->kmeansMode == KMEANS_ELKAN);
+			int nIterations = conf->maxIterKmeans;
+			bool converged = false;
 			for (int maxIter = 0; maxIter < conf->maxIterKmeans; ++maxIter)
 			{
-				for (int k = 0; k < conf->K; ++k)
+				bool changed = false;
+
+				// Half of the distances between centroids. An instance nearer than it to its centroid cannot be nearer
+				// to the other centroid. 'half' keeps the smallest one of each centroid
+				if (bounded && maxIter > 0)
 				{
-					samples_in_k[k] = 0;
+					for (int k = 0; k < K; ++k)
+					{
+						half[k] = INFINITY;
+					}
+					for (int k = 0; k < K; ++k)
+					{
+						for (int k2 = k + 1; k2 < K; ++k2)
+						{
+							distance(centroids + (k * nSel), centroids + (k2 * nSel), 1, nSel, dist);
+							const double h = 0.5 * sqrt((double)dist[0]) * shrink;
+							halfPairs[(k * K) + k2] = halfPairs[(k2 * K) + k] = h;
+							half[k] = std::min(half[k], h);
+							half[k2] = std::min(half[k2], h);
+						}
+					}
 				}
 
 				// Calculate all distances (Euclidean distance) between each instance and the centroids
 				for (int i = 0; i < conf->trNInstances; ++i)
 				{
-					float minDist = INFINITY;
-					int selectCentroid;
-					int pos = conf->nFeatures * i;
-					for (int k = 0, posCentr = 0; k < conf->K; ++k, posCentr += conf->nFeatures)
+					const float *const subRow = subDataBase + (nSel * i);
+					double *const lowerRow = lower + (K * i);
+
+					// Only the centroids which the bounds cannot discard are visited. The discarded ones are farther
+					// than the current centroid by a margin larger than the rounding errors, so the brute force would
+					// not choose them either
+					if (bounded && maxIter > 0)
 					{
-						float dist = 0.0f;
-						for (int f = 0; f < conf->nFeatures; ++f)
+						const int current = mapping[i];
+						const double *const halfRow = halfPairs + (current * K);
+						if (upper[i] * grow < half[current] * shrink)
+						{
+							stale[i] = true;
+							continue;
+						}
+
+						int nVisit = 0;
+						for (int k = 0; k < K; ++k)
+						{
+							visit[k] = (k != current && upper[i] * grow >= std::max(lowerRow[k], halfRow[k]) * shrink);
+							nVisit += visit[k];
+						}
+						if (nVisit == 0)
+						{
+							stale[i] = true;
+							continue;
+						}
+
+						// The distances are the same whether they are computed one by one or all at once. The latter
+						// shares the loads of the instance, so it is preferred when few centroids can be discarded
+						if (2 * nVisit >= K)
+						{
+							distances(subRow, centroids, K, nSel, dist);
+							for (int k = 0; k < K; ++k)
+							{
+								visit[k] = true;
+							}
+						}
+						else
 						{
-							if (subpop[ind].chromosome[f])
+
+							// Tighten the upper bound with the distance to the current centroid and try again
+							distance(subRow, centroids + (current * nSel), 1, nSel, dist + current);
+							upper[i] = sqrt((double)dist[current]) * grow;
+							for (int k = 0; k < K; ++k)
 							{
-								float dif = trDataBase[pos + f] - centroids[posCentr + f];
-								dist += dif * dif;
+								if (visit[k] && upper[i] * grow >= std::max(lowerRow[k], halfRow[k]) * shrink)
+								{
+									distance(subRow, centroids + (k * nSel), 1, nSel, dist + k);
+								}
+								else
+								{
+									visit[k] = false;
+								}
 							}
+							visit[current] = true;
 						}
+					}
+					else
+					{
+						distances(subRow, centroids, K, nSel, dist);
+						for (int k = 0; k < K; ++k)
+						{
+							visit[k] = true;
+						}
+					}
 
-						if (dist < minDist)
+					// If no distance is a number (e.g. constant features normalized by a zero deviation), the instance
+					// keeps its cluster instead of indexing the sums with garbage
+					float minDist = INFINITY;
+					int selectCentroid = mapping[i];
+					for (int k = 0; k < K; ++k)
+					{
+						if (visit[k] && dist[k] < minDist)
 						{
-							minDist = dist;
+							minDist = dist[k];
 							selectCentroid = k;
 						}
 					}
 
 					distCentroids[i] = minDist;
-					samples_in_k[selectCentroid]++;
 					if (mapping[i] != selectCentroid)
 					{
 						mapping[i] = selectCentroid;
+						changed = true;
 					}
-				}
 
-				// Update the position of the centroids
-				for (int f = 0; f < conf->nFeatures; ++f)
-				{
-					if (subpop[ind].chromosome[f])
+					// The bounds are reset with the distances just computed
+					if (bounded)
 					{
-						for (int k = 0; k < conf->K; ++k)
+						upper[i] = sqrt((double)minDist) * grow;
+						for (int k = 0; k < K; ++k)
 						{
-							float sum = 0.0f;
-							for (int i = 0; i < conf->trNInstances; ++i)
+							if (visit[k])
 							{
-								if (mapping[i] == k)
-								{
-									sum += trDataBase[(conf->nFeatures * i) + f];
-								}
+								lowerRow[k] = sqrt((double)dist[k]) * shrink;
 							}
-							centroids[(k * conf->nFeatures) + f] = (samples_in_k[k] > 0) ? sum / samples_in_k[k] : centroids[(k * conf->nFeatures) + f];
 						}
+						stale[i] = false;
+					}
+				}
+
+				// If no instance has changed its cluster, the centroids (and so the distances) would not change
+				// anymore. The first iteration always updates them because the mapping table starts at cluster 0
+				if (!changed && maxIter > 0)
+				{
+					nIterations = maxIter + 1;
+					converged = true;
+					break;
+				}
+
+				// The bounded mode needs the previous centroids to know how much each one moves
+				if (bounded)
+				{
+					std::copy(centroids, centroids + totalCoord, oldCentroids);
+				}
+
+				// Update the position of the centroids. The instances are streamed once, adding each one to the sum of its
+				// cluster. Each sum still adds the instances in order, so the centroids do not change
+				for (int k = 0; k < K; ++k)
+				{
+					samples_in_k[k] = 0;
+				}
+				for (int posCentr = 0; posCentr < totalCoord; ++posCentr)
+				{
+					sums[posCentr] = 0.0f;
+				}
+				for (int i = 0; i < conf->trNInstances; ++i)
+				{
+					const float *const subRow = subDataBase + (nSel * i);
+					float *const sum = sums + (mapping[i] * nSel);
+					for (int j = 0; j < nSel; ++j)
+					{
+						sum[j] += subRow[j];
+					}
+					samples_in_k[mapping[i]]++;
+				}
+				for (int k = 0; k < K; ++k)
+				{
+					if (samples_in_k[k] > 0)
+					{
+						for (int j = 0; j < nSel; ++j)
+						{
+							centroids[(k * nSel) + j] = sums[(k * nSel) + j] / samples_in_k[k];
+						}
+					}
+				}
+
+				// The bounds are moved as much as the centroids have moved
+				if (bounded)
+				{
+					for (int k = 0; k < K; ++k)
+					{
+						distance(oldCentroids + (k * nSel), centroids + (k * nSel), 1, nSel, dist);
+						drift[k] = sqrt((double)dist[0]) * grow;
+					}
+					for (int i = 0; i < conf->trNInstances; ++i)
+					{
+						upper[i] += drift[mapping[i]];
+						for (int k = 0; k < K; ++k)
+						{
+							lower[(K * i) + k] -= drift[k];
+						}
+					}
+				}
+			}
+
+			// The distances skipped thanks to the bounds are computed against the centroids of the last assignment step
+			if (bounded)
+			{
+				const float *const lastCentroids = (converged) ? centroids : oldCentroids;
+				for (int i = 0; i < conf->trNInstances; ++i)
+				{
+					if (stale[i])
+					{
+						distance(subDataBase + (nSel * i), lastCentroids + (mapping[i] * nSel), 1, nSel, dist);
+						distCentroids[i] = dist[0];
 					}
 				}
 			}
@@ -142,103 +401,336 @@ void evaluationCPU(Individual *const subpop, const int nIndividuals, const float
 			}
 
 			// Inter-cluster
-			for (int posCentr = 0; posCentr < totalCoord; posCentr += conf->nFeatures)
+			for (int posCentr = 0; posCentr < totalCoord; posCentr += nSel)
 			{
-				for (int i = posCentr + conf->nFeatures; i < totalCoord; i += conf->nFeatures)
+				for (int i = posCentr + nSel; i < totalCoord; i += nSel)
 				{
 					float sum = 0.0f;
-					for (int f = 0; f < conf->nFeatures; ++f)
+					for (int j = 0; j < nSel; ++j)
 					{
-						if (subpop[ind].chromosome[f])
-						{
-							sum += (centroids[posCentr + f] - centroids[i + f]) * (centroids[posCentr + f] - centroids[i + f]);
-						}
+						sum += (centroids[posCentr + j] - centroids[i + j]) * (centroids[posCentr + j] - centroids[i + j]);
 					}
 					sumInter += sqrt(sum);
 				}
 			}
 
-			subpop[ind].fitness[0] = sumWithin;
-			subpop[ind].fitness[1] = sumInter;
+			subpop.fitness[0][ind] = sumWithin;
+			subpop.fitness[1][ind] = sumInter;
+			++iterations[nIterations];
 		}
+
+		addKmeansIterations(iterations, conf);
 	}
+
+	arena->release(mark);
 }
 
 /**
- * @brief Evaluation of each individual on OpenCL devices
+ * @brief Evaluation of each individual in CPU in Sequential mode or using OpenMP
  * @param subpop The first individual to evaluate of the current subpopulation
  * @param nIndividuals The number of individuals which will be evaluated
- * @param devicesObject Structure containing the OpenCL variables of a device
- * @param nDevices The number of devices that will execute the evaluation
  * @param trDataBase The training database which will contain the instances and the features
  * @param selInstances The instances choosen as initial centroids
+ * @param nThreads The number of threads to perform the individuals evaluation
+ * @param arena The scratch arena where the buffers of the threads are stored
  * @param conf The structure with all configuration parameters
  */
-void evaluation(Individual *const subpop, const int nIndividuals, CLDevice *const devicesObject, const int nDevices, const float *const trDataBase, const int *const selInstances, const Config *const conf)
+void evaluationCPU(const Subpopulation subpop, const int nIndividuals, const float *const trDataBase, const int *const selInstances, const int nThreads, ScratchArena *const arena, const Config *const conf)
 {
-#if LOG_ENABLED
-	std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Starting evaluation for " << nIndividuals << " individuals on " << nDevices << " devices" << std::endl;
-#endif
 
-	int index = 0;
+	// The distance kernels are selected once, for the instruction set of the configuration
+	static const DistancesKernel distances = selectDistancesKernel(conf->K, conf);
+	static const DistancesKernel distance = selectDistancesKernel(1, conf);
 
-#pragma omp parallel num_threads(nDevices)
+	// The most common numbers of centroids have their own K-means
+	switch (conf->K)
 	{
-		int begin, end, maxProcessing;
-		bool finished = false;
-		int threadID = omp_get_thread_num();
-		cl_int status;
-		cl_event kernelEvent, copyEvent;
+	case 2:
+		kmeansCPU<2>(subpop, nIndividuals, trDataBase, selInstances, nThreads, arena, distances, distance, conf);
+		break;
+	case 3:
+		kmeansCPU<3>(subpop, nIndividuals, trDataBase, selInstances, nThreads, arena, distances, distance, conf);
+		break;
+	case 4:
+		kmeansCPU<4>(subpop, nIndividuals, trDataBase, selInstances, nThreads, arena, distances, distance, conf);
+		break;
+	case 5:
+		kmeansCPU<5>(subpop, nIndividuals, trDataBase, selInstances, nThreads, arena, distances, distance, conf);
+		break;
+	case 6:
+		kmeansCPU<6>(subpop, nIndividuals, trDataBase, selInstances, nThreads, arena, distances, distance, conf);
+		break;
+	case 7:
+		kmeansCPU<7>(subpop, nIndividuals, trDataBase, selInstances, nThreads, arena, distances, distance, conf);
+		break;
+	case 8:
+		kmeansCPU<8>(subpop, nIndividuals, trDataBase, selInstances, nThreads, arena, distances, distance, conf);
+		break;
+	default:
+		kmeansCPU<0>(subpop, nIndividuals, trDataBase, selInstances, nThreads, arena, distances, distance, conf);
+	}
+}
 
-		// Start the copy onto the devices
-		if (devicesObject[threadID].deviceType != CL_DEVICE_TYPE_CPU)
+/**
+ * @brief Takes the next chunk of individuals to be evaluated. The devices take the chunks as a deck
+ *
+ * Each device takes a part of the remaining individuals proportional to its measured throughput, divided by 'EV_GUIDED_FACTOR', so the
+ * chunks decrease towards the end and no device is left with a long chunk while the others are idle. A device which has not been measured
+ * yet takes one individual per compute unit. A single OpenMP device takes all the individuals at once
+ * @param index The first individual which has not been taken yet by any device
+ * @param nIndividuals The number of individuals to be evaluated
+ * @param devicesObject Structure containing the OpenCL variables of the devices
+ * @param nDevices The number of devices that will execute the evaluation
+ * @param dev The device taking the chunk
+ * @param begin Where the first individual of the chunk is stored
+ * @param end Where the 'end-1' position of the last individual of the chunk is stored
+ * @return false if there are no individuals left
+ */
+static bool nextChunk(int *const index, const int nIndividuals, const CLDevice *const devicesObject, const int nDevices, const int dev, int *const begin, int *const end)
+{
+
+#pragma omp critical(evaluationDeck)
+	{
+		int remaining = nIndividuals - *index;
+		int chunk = remaining;
+		if (nDevices > 1 || devicesObject[dev].isOpenCL)
 		{
-			check(clEnqueueWriteBuffer(devicesObject[threadID].commandQueue, devicesObject[threadID].objSubpopulations, CL_FALSE, 0, nIndividuals * sizeof(Individual), subpop, 0, NULL, &copyEvent) != CL_SUCCESS, "%s\n", EV_ERROR_ENQUEUE_INDIVIDUALS);
+			double totalThroughput = 0.0;
+			for (int d = 0; d < nDevices; ++d)
+			{
+				totalThroughput += devicesObject[d].throughput;
+			}
+			chunk = (devicesObject[dev].throughput > 0.0) ? (int)ceil(remaining * devicesObject[dev].throughput / (totalThroughput * EV_GUIDED_FACTOR)) : 0;
+			chunk = std::max(chunk, devicesObject[dev].computeUnits);
+			if (devicesObject[dev].isOpenCL)
+			{
+				chunk = std::min(chunk, EV_MAX_CHUNK_OPENCL);
+			}
 		}
 
-		// Only 1 device (CPU or GPU)
-		if (nDevices == 1)
+		*begin = *index;
+		*end = *begin + std::max(0, std::min(chunk, remaining));
+		*index = *end;
+	}
+
+	return *begin < *end;
+}
+
+/**
+ * @brief Updates the throughput of a device each time it completes a chunk
+ *
+ * The rate of the current batch (all its completed chunks, so the delays of the host do not count) is smoothed with the throughput
+ * of the previous batches, so the learned weights persist across generations
+ * @param device Structure containing the OpenCL variables of the device
+ * @param previousThroughput The throughput of the device before the current batch (0 if not measured yet)
+ * @param nIndividuals The number of individuals evaluated by the device in the current batch
+ * @param seconds The time since the device started the current batch
+ */
+static void updateThroughput(CLDevice &device, const double previousThroughput, const int nIndividuals, const double seconds)
+{
+
+	if (seconds > 0.0)
+	{
+		double rate = nIndividuals / seconds;
+
+#pragma omp critical(evaluationDeck)
+		device.throughput = (previousThroughput > 0.0) ? (EV_THROUGHPUT_SMOOTHING * rate) + ((1.0 - EV_THROUGHPUT_SMOOTHING) * previousThroughput) : rate;
+	}
+}
+
+/**
+ * @brief Evaluation of the chunks taken by an OpenCL device
+ *
+ * The chunks are pipelined with two command queues: while the kernel of a chunk runs on 'commandQueue', the chromosomes
+ * of the next chunk are uploaded and the fitness of the previous one is read back on 'transferQueue'. The readings go
+ * to two host buffers used alternately, and only the fitness and the K-means iterations are read back
+ * @param subpop The first individual to evaluate of the current subpopulation
+ * @param nIndividuals The number of individuals to be evaluated
+ * @param index The first individual which has not been taken yet by any device
+ * @param devicesObject Structure containing the OpenCL variables of the devices
+ * @param nDevices The number of devices that will execute the evaluation
+ * @param dev The OpenCL device of this thread
+ * @param conf The structure with all configuration parameters
+ */
+static void evaluationCL(const Subpopulation subpop, const int nIndividuals, int *const index, CLDevice *const devicesObject, const int nDevices, const int dev, const Config *const conf)
+{
+
+	// The readings of the current chunk and the previous one (still in flight) go to different halves of the host buffers
+	CLDevice &device = devicesObject[dev];
+	float *const fitness[2] = {device.hostFitness, device.hostFitness + ((size_t)conf->familySize * conf->nObjectives)};
+	int *const nIterations[2] = {device.hostIterations, device.hostIterations + conf->familySize};
+	cl_event uploadEvent, readEvents[2][2];
+	int slot = 0;
+	int begin, end, prevBegin, prevEnd, nextBegin, nextEnd;
+	bool pending = false;
+
+	// Upload the first chunk
+	double start = omp_get_wtime();
+	double previousThroughput = device.throughput;
+	int nCompleted = 0;
+	bool found = nextChunk(index, nIndividuals, devicesObject, nDevices, dev, &begin, &end);
+	if (found)
+	{
+		check(clEnqueueWriteBuffer(device.transferQueue, device.objChromosomes, CL_FALSE, (size_t)begin * conf->nWords * sizeof(cl_ulong), (size_t)(end - begin) * conf->nWords * sizeof(cl_ulong), subpop.chromosome(begin), 0, NULL, &uploadEvent) != CL_SUCCESS, "%s\n", EV_ERROR_ENQUEUE_INDIVIDUALS);
+	}
+
+	while (found || pending)
+	{
+
+		// Run the kernel once its chunk has been uploaded
+		cl_event kernelEvent;
+		if (found)
 		{
-			int maxIndividualsOnGpuKernel = 10000;
-			maxProcessing = (devicesObject[threadID].deviceType == CL_DEVICE_TYPE_GPU) ? std::min(nIndividuals, maxIndividualsOnGpuKernel) : nIndividuals;
+			check(clSetKernelArg(device.kernel, 3, sizeof(int), &begin) != CL_SUCCESS, "%s\n", EV_ERROR_KERNEL_ARGUMENT4);
+			check(clSetKernelArg(device.kernel, 4, sizeof(int), &end) != CL_SUCCESS, "%s\n", EV_ERROR_KERNEL_ARGUMENT5);
+			check(clEnqueueNDRangeKernel(device.commandQueue, device.kernel, 1, NULL, &(device.wiGlobal), &(device.wiLocal), 1, &uploadEvent, &kernelEvent) != CL_SUCCESS, "%s\n", EV_ERROR_ENQUEUE_KERNEL);
+			clReleaseEvent(uploadEvent);
+			clFlush(device.commandQueue);
 		}
-		// Heterogeneous mode
-		else
+
+		// The previous chunk is completed while the current one is computed
+		if (pending)
 		{
-			maxProcessing = devicesObject[threadID].computeUnits;
+			int prevSlot = 1 - slot;
+			check(clWaitForEvents(2, readEvents[prevSlot]) != CL_SUCCESS, "%s\n", EV_ERROR_ENQUEUE_READING);
+			clReleaseEvent(readEvents[prevSlot][0]);
+			clReleaseEvent(readEvents[prevSlot][1]);
+
+			nCompleted += prevEnd - prevBegin;
+			updateThroughput(device, previousThroughput, nCompleted, omp_get_wtime() - start);
+
+			for (int i = 0; i < prevEnd - prevBegin; ++i)
+			{
+				for (unsigned char obj = 0; obj < conf->nObjectives; ++obj)
+				{
+					subpop.fitness[obj][prevBegin + i] = fitness[prevSlot][(i * conf->nObjectives) + obj];
+				}
+			}
+
+			// Histogram of the iterations executed by K-means in this chunk
+			long int iterations[conf->maxIterKmeans + 1];
+			for (int i = 0; i <= conf->maxIterKmeans; ++i)
+			{
+				iterations[i] = 0;
+			}
+			for (int i = 0; i < prevEnd - prevBegin; ++i)
+			{
+				++iterations[nIterations[prevSlot][i]];
+			}
+			addKmeansIterations(iterations, conf);
 		}
 
-		do
+		// The next chunk is taken once the previous one has finished, so a device has at most two chunks, and is uploaded while the kernel runs
+		bool nextFound = false;
+		if (found)
 		{
-#pragma omp atomic capture
+			nextFound = nextChunk(index, nIndividuals, devicesObject, nDevices, dev, &nextBegin, &nextEnd);
+			if (nextFound)
 			{
-				begin = index;
-				index += maxProcessing;
+				check(clEnqueueWriteBuffer(device.transferQueue, device.objChromosomes, CL_FALSE, (size_t)nextBegin * conf->nWords * sizeof(cl_ulong), (size_t)(nextEnd - nextBegin) * conf->nWords * sizeof(cl_ulong), subpop.chromosome(nextBegin), 0, NULL, &uploadEvent) != CL_SUCCESS, "%s\n", EV_ERROR_ENQUEUE_INDIVIDUALS);
 			}
 
-			if (begin < nIndividuals)
-			{
-				end = (begin + maxProcessing >= nIndividuals) ? nIndividuals : begin + maxProcessing;
+			// Only the fitness of the chunk is read back, interleaved by individual, besides the iterations of K-means. They are enqueued after the upload, as they wait for the kernel
+			check(clEnqueueReadBuffer(device.transferQueue, device.objFitness, CL_FALSE, (size_t)begin * conf->nObjectives * sizeof(cl_float), (size_t)(end - begin) * conf->nObjectives * sizeof(cl_float), fitness[slot], 1, &kernelEvent, &readEvents[slot][0]) != CL_SUCCESS, "%s\n", EV_ERROR_ENQUEUE_READING);
+			check(clEnqueueReadBuffer(device.transferQueue, device.objIterations, CL_FALSE, begin * sizeof(cl_int), (end - begin) * sizeof(cl_int), nIterations[slot], 1, &kernelEvent, &readEvents[slot][1]) != CL_SUCCESS, "%s\n", EV_ERROR_ENQUEUE_READING);
+			clReleaseEvent(kernelEvent);
+			clFlush(device.transferQueue);
+		}
 
-				if (devicesObject[threadID].deviceType != CL_DEVICE_TYPE_CPU)
-				{
-					check(clSetKernelArg(devicesObject[threadID].kernel, 3, sizeof(int), &begin) != CL_SUCCESS, "%s\n", EV_ERROR_KERNEL_ARGUMENT4);
-					check(clSetKernelArg(devicesObject[threadID].kernel, 4, sizeof(int), &end) != CL_SUCCESS, "%s\n", EV_ERROR_KERNEL_ARGUMENT5);
+		pending = found;
+		if (found)
+		{
+			prevBegin = begin;
+			prevEnd = end;
+			begin = nextBegin;
+			end = nextEnd;
+			slot = 1 - slot;
+		}
+		found = nextFound;
+	}
+}
 
-					check((status = clEnqueueNDRangeKernel(devicesObject[threadID].commandQueue, devicesObject[threadID].kernel, 1, NULL, &(devicesObject[threadID].wiGlobal), &(devicesObject[threadID].wiLocal), 1, &copyEvent, &kernelEvent)) != CL_SUCCESS, "%s\n", EV_ERROR_ENQUEUE_KERNEL);
+/**
+ * @brief Evaluation of each individual on OpenCL devices
+ * @param subpop The first individual to evaluate of the current subpopulation
+ * @param nIndividuals The number of individuals which will be evaluated
+ * @param devicesObject Structure containing the OpenCL variables of a device
+ * @param nDevices The number of devices that will execute the evaluation
+ * @param trDataBase The training database which will contain the instances and the features
+ * @param selInstances The instances choosen as initial centroids
+ * @param fitnessCache The cache with the raw fitness of the already evaluated chromosomes (NULL if disabled)
+ * @param arena The scratch arena of the island, used by the CPU evaluation
+ * @param conf The structure with all configuration parameters
+ */
+void evaluation(const Subpopulation subpop, const int nIndividuals, CLDevice *const devicesObject, const int nDevices, const float *const trDataBase, const int *const selInstances, FitnessCache *const fitnessCache, ScratchArena *const arena, const Config *const conf)
+{
+#if LOG_ENABLED
+	std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: Starting evaluation for " << nIndividuals << " individuals on " << nDevices << " devices" << std::endl;
+#endif
 
-					check((status = clEnqueueReadBuffer(devicesObject[threadID].commandQueue, devicesObject[threadID].objSubpopulations, CL_TRUE, begin * sizeof(Individual), (end - begin) * sizeof(Individual), subpop + begin, 1, &kernelEvent, NULL)) != CL_SUCCESS, "%s\n", EV_ERROR_ENQUEUE_READING);
-				}
-				else
+	// The individuals found in the cache take their raw fitness from it. The rest are moved to the front to be evaluated
+	int nToEvaluate = nIndividuals;
+	if (fitnessCache != NULL)
+	{
+		nToEvaluate = 0;
+		for (int i = 0; i < nIndividuals; ++i)
+		{
+			float fitness[2];
+			if (fitnessCache->lookup(subpop.chromosome(i), fitness))
+			{
+				subpop.fitness[0][i] = fitness[0];
+				subpop.fitness[1][i] = fitness[1];
+			}
+			else
+			{
+				if (i != nToEvaluate)
 				{
-					evaluationCPU(subpop + begin, end - begin, trDataBase, selInstances, devicesObject[threadID].computeUnits, conf);
+					swapIndividuals(subpop, i, nToEvaluate);
 				}
+				++nToEvaluate;
 			}
-			else
+		}
+#if LOG_ENABLED
+		std::cout << "Process " << conf->mpiRank << " [" << __func__ << "]: " << nIndividuals - nToEvaluate << " individuals found in the fitness cache" << std::endl;
+#endif
+	}
+
+	int index = 0;
+
+#pragma omp parallel num_threads(nDevices)
+	{
+		int begin, end;
+		int threadID = omp_get_thread_num();
+
+		if (devicesObject[threadID].isOpenCL)
+		{
+			if (nToEvaluate > 0)
+			{
+				evaluationCL(subpop, nToEvaluate, &index, devicesObject, nDevices, threadID, conf);
+			}
+		}
+		else
+		{
+			double start = omp_get_wtime();
+			double previousThroughput = devicesObject[threadID].throughput;
+			int nCompleted = 0;
+			while (nextChunk(&index, nToEvaluate, devicesObject, nDevices, threadID, &begin, &end))
 			{
-				finished = true;
+				evaluationCPU(subpop.from(begin), end - begin, trDataBase, selInstances, devicesObject[threadID].computeUnits, arena, conf);
+				nCompleted += end - begin;
+				updateThroughput(devicesObject[threadID], previousThroughput, nCompleted, omp_get_wtime() - start);
 			}
-		} while (!finished);
+		}
+	}
+
+	// The raw fitness of the new chromosomes is stored before normalizing
+	if (fitnessCache != NULL)
+	{
+		for (int i = 0; i < nToEvaluate; ++i)
+		{
+			const float fitness[2] = {subpop.fitness[0][i], subpop.fitness[1][i]};
+			fitnessCache->insert(subpop.chromosome(i), fitness);
+		}
 	}
 
 	normalizeFitness(subpop, nIndividuals, conf);
@@ -247,13 +739,43 @@ void evaluation(Individual *const subpop, const int nIndividuals, CLDevice *cons
 #endif
 }
 
+/**
+ * @brief Prints the histogram of the iterations executed by K-means in this process
+ * @param conf The structure with all configuration parameters
+ */
+void printKmeansStats(const Config *const conf)
+{
+
+	long int runs = 0;
+	long int total = 0;
+	for (size_t i = 0; i < kmeansIterations.size(); ++i)
+	{
+		runs += kmeansIterations[i];
+		total += i * kmeansIterations[i];
+	}
+
+	if (runs > 0)
+	{
+		fprintf(stdout, "Process %d: K-means runs: %ld, mean iterations: %.2f, converged before the limit: %.2f%%\n", conf->mpiRank, runs, (double)total / runs, 100.0 * (runs - kmeansIterations[conf->maxIterKmeans]) / runs);
+		fprintf(stdout, "Process %d: K-means iterations histogram:", conf->mpiRank);
+		for (size_t i = 1; i < kmeansIterations.size(); ++i)
+		{
+			if (kmeansIterations[i] > 0)
+			{
+				fprintf(stdout, " %zu:%ld", i, kmeansIterations[i]);
+			}
+		}
+		fprintf(stdout, "\n");
+	}
+}
+
 /**
  * @brief Normalize the fitness for each individual
  * @param subpop The first individual to normalize of the current subpopulation
  * @param nIndividuals The number of individuals which will be normalized
  * @param conf The structure with all configuration parameters
  */
-void normalizeFitness(Individual *const subpop, const int nIndividuals, const Config *const conf)
+void normalizeFitness(const Subpopulation subpop, const int nIndividuals, const Config *const conf)
 {
 
 	for (unsigned char obj = 0; obj < conf->nObjectives; ++obj)
@@ -263,7 +785,7 @@ void normalizeFitness(Individual *const subpop, const int nIndividuals, const Co
 		float average = 0;
 		for (int i = 0; i < nIndividuals; ++i)
 		{
-			average += subpop[i].fitness[obj];
+			average += subpop.fitness[obj][i];
 		}
 
 		average /= nIndividuals;
@@ -272,7 +794,8 @@ void normalizeFitness(Individual *const subpop, const int nIndividuals, const Co
 		float variance = 0;
 		for (int i = 0; i < nIndividuals; ++i)
 		{
-			variance += (subpop[i].fitness[obj] - average) * (subpop[i].fitness[obj] - average);
+			float fitness = subpop.fitness[obj][i];
+			variance += (fitness - average) * (fitness - average);
 		}
 		variance /= (nIndividuals - 1);
 
@@ -286,9 +809,9 @@ void normalizeFitness(Individual *const subpop, const int nIndividuals, const Co
 			// Normalize a set of continuous values using SoftMax (based on the logistic function)
 			for (int i = 0; i < nIndividuals; ++i)
 			{
-				float x_scaled = (subpop[i].fitness[obj] - average) / std_deviation;
+				float x_scaled = (subpop.fitness[obj][i] - average) / std_deviation;
 				float x_new = 1.0f / (1.0f + exp(-x_scaled));
-				subpop[i].fitness[obj] = -x_new;
+				subpop.fitness[obj][i] = -x_new;
 			}
 		}
 		else
@@ -297,8 +820,8 @@ void normalizeFitness(Individual *const subpop, const int nIndividuals, const Co
 			// Normalize a set of continuous values using SoftMax (based on the logistic function)
 			for (int i = 0; i < nIndividuals; ++i)
 			{
-				float x_scaled = (subpop[i].fitness[obj] - average) / std_deviation;
-				subpop[i].fitness[obj] = 1.0f / (1.0f + exp(-x_scaled));
+				float x_scaled = (subpop.fitness[obj][i] - average) / std_deviation;
+				subpop.fitness[obj][i] = 1.0f / (1.0f + exp(-x_scaled));
 			}
 		}
 	}
@@ -308,30 +831,29 @@ void normalizeFitness(Individual *const subpop, const int nIndividuals, const Co
  * @brief Gets the hypervolume measure of the subpopulation
  * @param subpop Current subpopulation
  * @param nIndFront0 The number of individuals in the front 0
+ * @param arena The scratch arena where the points are stored
  * @param conf The structure with all configuration parameters
  * @return The value of the hypervolume
  */
-float getHypervolume(const Individual *const subpop, const int nIndFront0, const Config *const conf)
+float getHypervolume(const Subpopulation subpop, const int nIndFront0, ScratchArena *const arena, const Config *const conf)
 {
 
 	// Generation the points for the calculation of the hypervolume
-	double **points = new double *[nIndFront0];
+	const size_t mark = arena->mark();
+	double **points = arena->allocate<double *>(nIndFront0);
+	double *coordinates = arena->allocate<double>((size_t)nIndFront0 * conf->nObjectives);
 	for (int i = 0; i < nIndFront0; ++i)
 	{
-		points[i] = new double[conf->nObjectives];
+		points[i] = coordinates + i * conf->nObjectives;
 		for (unsigned char obj = 0; obj < conf->nObjectives; ++obj)
 		{
-			points[i][obj] = (obj == 0) ? 1 - subpop[i].fitness[obj] : -subpop[i].fitness[obj];
+			points[i][obj] = (obj == 0) ? 1 - subpop.fitness[obj][i] : -subpop.fitness[obj][i];
 		}
 	}
 
 	// The reference point is the origin point
 	float hypervolume = fabs(GetHypervolume(points, nIndFront0, conf->nObjectives));
-	for (int i = 0; i < nIndFront0; ++i)
-	{
-		delete[] points[i];
-	}
-	delete[] points;
+	arena->release(mark);
 
 	return hypervolume;
 }
@@ -345,6 +867,7 @@ int *getCentroids(const Config *const conf)
 {
 
 	// The init centroids will be instances choosen randomly (Forgy's Method)
+	RandomGenerator rng(conf->seed, RNG_CENTROIDS, 0, 0);
 	int *selInstances = new int[conf->K];
 	for (int k = 0; k < conf->K; ++k)
 	{
@@ -354,7 +877,7 @@ int *getCentroids(const Config *const conf)
 		// Avoid repeat centroids
 		do
 		{
-			randomInstance = rand() % conf->trNInstances;
+			randomInstance = rng.nextInt(conf->trNInstances);
 			exists = false;
 
 			// Look if the generated index already exists
@@ -376,7 +899,7 @@ int *getCentroids(const Config *const conf)
  * @param nIndFront0 The number of individuals in the front 0
  * @param conf The structure with all configuration parameters
  */
-void generateDataPlot(const Individual *const subpop, const int nIndFront0, const Config *const conf)
+void generateDataPlot(const Subpopulation subpop, const int nIndFront0, const Config *const conf)
 {
 
 	// Open the data file
@@ -391,10 +914,10 @@ void generateDataPlot(const Individual *const subpop, const int nIndFront0, cons
 	}
 	for (int i = 0; i < nIndFront0; ++i)
 	{
-		fprintf(f_data, "\n%f", subpop[i].fitness[0]);
+		fprintf(f_data, "\n%f", subpop.fitness[0][i]);
 		for (unsigned char obj = 1; obj < conf->nObjectives; ++obj)
 		{
-			fprintf(f_data, "\t%f", subpop[i].fitness[obj]);
+			fprintf(f_data, "\t%f", subpop.fitness[obj][i]);
 		}
 	}
 
@@ -0,0 +1,255 @@
+/**
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE', which is part of Hpmoon repository.
+ *
+ * This work has been funded by:
+ *
+ * Spanish 'Ministerio de Economía y Competitividad' under grants number TIN2012-32039 and TIN2015-67020-P.\n
+ * Spanish 'Ministerio de Ciencia, Innovación y Universidades' under grant number PGC2018-098813-B-C31.\n
+ * European Regional Development Fund (ERDF).
+ *
+ * @file fitnessCache.cpp
+ * @author agent
+ * @date 17/10/2026
+ * @brief Implementation of the fitness memoization cache
+ * @copyright Hpmoon (c) 2015 EFFICOMP
+ */
+
+/********************************* Includes *******************************/
+
+#include "fitnessCache.h"
+#include <algorithm> // std::fill
+#include <stdio.h>	 // fprintf
+#include <string.h>	 // memcmp, memcpy
+
+/********************************* Methods ********************************/
+
+/**
+ * @brief The constructor with parameters
+ * @param conf The structure with all configuration parameters
+ * @return An empty cache
+ */
+FitnessCache::FitnessCache(const Config *const conf)
+{
+
+	this->capacity = conf->fitnessCacheSize;
+	this->nWords = conf->nWords;
+	this->hits = 0;
+	this->misses = 0;
+	this->evictions = 0;
+	this->nEntries = 0;
+	this->head = -1;
+	this->tail = -1;
+	this->entries = new CacheEntry[this->capacity];
+	this->chromosomes = new uint64_t[(size_t)this->capacity * this->nWords];
+
+	size_t nSlots = 1;
+	while (nSlots < 2 * (size_t)this->capacity)
+	{
+		nSlots <<= 1;
+	}
+	this->index = new int[nSlots];
+	std::fill(this->index, this->index + nSlots, -1);
+	this->indexMask = nSlots - 1;
+	omp_init_lock(&(this->lock));
+}
+
+/**
+ * @brief The destructor
+ */
+FitnessCache::~FitnessCache()
+{
+
+	delete[] this->entries;
+	delete[] this->chromosomes;
+	delete[] this->index;
+	omp_destroy_lock(&(this->lock));
+}
+
+/**
+ * @brief Looks for the raw fitness of a chromosome
+ * @param chromosome The bit-packed chromosome
+ * @param fitness Where the raw fitness is stored if the chromosome is found
+ * @return true if the chromosome is found
+ */
+bool FitnessCache::lookup(const uint64_t *const chromosome, float *const fitness)
+{
+
+	uint64_t hash = hashChromosome(chromosome, this->nWords);
+	bool found = false;
+
+	omp_set_lock(&(this->lock));
+	int e = this->index[findSlot(hash)];
+	if (e >= 0 && memcmp(this->chromosomes + ((size_t)e * this->nWords), chromosome, this->nWords * sizeof(uint64_t)) == 0)
+	{
+
+		// The entry becomes the most recently used
+		moveToFront(e, true);
+		fitness[0] = this->entries[e].fitness[0];
+		fitness[1] = this->entries[e].fitness[1];
+		found = true;
+		++(this->hits);
+	}
+	else
+	{
+		++(this->misses);
+	}
+	omp_unset_lock(&(this->lock));
+
+	return found;
+}
+
+/**
+ * @brief Stores the raw fitness of a chromosome
+ * @param chromosome The bit-packed chromosome
+ * @param fitness The raw fitness of the chromosome
+ */
+void FitnessCache::insert(const uint64_t *const chromosome, const float *const fitness)
+{
+
+	uint64_t hash = hashChromosome(chromosome, this->nWords);
+
+	omp_set_lock(&(this->lock));
+	size_t slot = findSlot(hash);
+	int e = this->index[slot];
+
+	// Already stored (by another island) or hash collision: the entry is overwritten
+	if (e >= 0)
+	{
+		moveToFront(e, true);
+	}
+
+	// A free entry is taken while there are any. Then, the least recently used entry is evicted and recycled
+	else if (this->nEntries < this->capacity)
+	{
+		e = (this->nEntries)++;
+		this->index[slot] = e;
+		moveToFront(e, false);
+	}
+	else
+	{
+		e = this->tail;
+		eraseSlot(findSlot(this->entries[e].hash));
+		this->index[findSlot(hash)] = e;
+		moveToFront(e, true);
+		++(this->evictions);
+	}
+
+	CacheEntry &entry = this->entries[e];
+	entry.hash = hash;
+	entry.fitness[0] = fitness[0];
+	entry.fitness[1] = fitness[1];
+	memcpy(this->chromosomes + ((size_t)e * this->nWords), chromosome, this->nWords * sizeof(uint64_t));
+	omp_unset_lock(&(this->lock));
+}
+
+/**
+ * @brief Gets the slot of the index which holds a hash, or the free slot where it would be inserted
+ * @param hash The hash of the chromosome
+ * @return The slot
+ */
+size_t FitnessCache::findSlot(const uint64_t hash) const
+{
+
+	size_t slot = hash & this->indexMask;
+	while (this->index[slot] >= 0 && this->entries[this->index[slot]].hash != hash)
+	{
+		slot = (slot + 1) & this->indexMask;
+	}
+
+	return slot;
+}
+
+/**
+ * @brief Frees a slot of the index. The following slots of the probe sequence are shifted back to fill the gap
+ * @param slot The slot
+ */
+void FitnessCache::eraseSlot(size_t slot)
+{
+
+	// An entry can fill the gap if the gap lies between its home slot and its current slot
+	for (size_t next = (slot + 1) & this->indexMask; this->index[next] >= 0; next = (next + 1) & this->indexMask)
+	{
+		size_t home = this->entries[this->index[next]].hash & this->indexMask;
+		if (((next - home) & this->indexMask) >= ((next - slot) & this->indexMask))
+		{
+			this->index[slot] = this->index[next];
+			slot = next;
+		}
+	}
+	this->index[slot] = -1;
+}
+
+/**
+ * @brief Makes an entry the most recently used one
+ * @param entry The entry
+ * @param linked false if the entry is new, so it is not in the list yet
+ */
+void FitnessCache::moveToFront(const int entry, const bool linked)
+{
+
+	CacheEntry &e = this->entries[entry];
+	if (linked)
+	{
+		if (this->head == entry)
+		{
+			return;
+		}
+
+		// Unlink the entry. It is not the head, so it has a previous entry
+		this->entries[e.prev].next = e.next;
+		if (e.next >= 0)
+		{
+			this->entries[e.next].prev = e.prev;
+		}
+		else
+		{
+			this->tail = e.prev;
+		}
+	}
+
+	e.prev = -1;
+	e.next = this->head;
+	if (this->head >= 0)
+	{
+		this->entries[this->head].prev = entry;
+	}
+	else
+	{
+		this->tail = entry;
+	}
+	this->head = entry;
+}
+
+/**
+ * @brief Prints the hit/miss counters of the cache
+ * @param conf The structure with all configuration parameters
+ */
+void FitnessCache::printStats(const Config *const conf)
+{
+
+	long int lookups = this->hits + this->misses;
+	fprintf(stdout, "Process %d: Fitness cache: %ld lookups, %ld hits (%.2f%%), %ld misses, %ld evictions, %d entries\n", conf->mpiRank, lookups, this->hits, (lookups > 0) ? (100.0 * this->hits) / lookups : 0.0, this->misses, this->evictions, this->nEntries);
+}
+
+/**
+ * @brief Gets the hash of a chromosome
+ * @param chromosome The bit-packed chromosome
+ * @param nWords The number of words of the chromosome
+ * @return The 64-bit hash
+ */
+uint64_t hashChromosome(const uint64_t *const chromosome, const int nWords)
+{
+
+	// Each word is combined and mixed with the SplitMix64 finalizer
+	uint64_t hash = 0x9E3779B97F4A7C15ULL;
+	for (int w = 0; w < nWords; ++w)
+	{
+		uint64_t z = hash ^ (chromosome[w] + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2));
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		hash = z ^ (z >> 31);
+	}
+
+	return hash;
+}
@@ -20,133 +20,425 @@
 #include "individual.h"
 #include <algorithm> // sort...
 #include <math.h>	 // INFINITY...
-#include <vector>	 // std::vector...
+#include <stdlib.h>	 // posix_memalign, free
+#include <string.h>	 // memcpy, memset
 
 /********************************* Methods ********************************/
 
 /**
- * @brief Perform non-dominated sorting on the subpopulation
- * @param subpop Current subpopulation
- * @param nIndividuals The number of individuals which will be sorted
+ * @brief Allocates an array of records. All the fields and chromosomes are set to zero
+ * @param nIndividuals The number of individuals
  * @param conf The structure with all configuration parameters
- * @return The number of individuals in the front 0
+ * @return The array of records
  */
-int nonDominationSort(Individual *const subpop, const int nIndividuals, const Config *const conf)
+Individual *createIndividuals(const int nIndividuals, const Config *const conf)
 {
 
-	// Individuals to classify (really they are not 'Individual' objects)
-	// Each 'Individual' p of 'indivDomination' contains the number of individuals...
-	// ...who dominate p and a list of individuals who are dominated by p
-	std::vector<std::pair<std::vector<int>, int>> indivDomination(nIndividuals);
-	std::vector<std::vector<int>> front(1);
+	// The records are allocated as words, so the chromosomes are aligned to 8 bytes
+	size_t nWords = ((size_t)nIndividuals * conf->individualSize) / sizeof(uint64_t);
+	return (Individual *)new uint64_t[nWords]();
+}
+
+/**
+ * @brief Releases an array of records allocated with 'createIndividuals'
+ * @param individuals The array of records
+ */
+void deleteIndividuals(Individual *const individuals)
+{
+	delete[] (uint64_t *)individuals;
+}
+
+/**
+ * @brief The constructor with parameters. All chromosomes, fitness and crowding distances are set to zero and all ranks to -1
+ * @param nIndividuals The number of individuals
+ * @param conf The structure with all configuration parameters
+ * @return An object containing the population
+ */
+Population::Population(const int nIndividuals, const Config *const conf)
+{
+
+	this->nIndividuals = nIndividuals;
+	this->nWords = conf->nWords;
+
+	// The chromosomes are aligned to a cache line, so the words of a chromosome are loaded with the fewest lines
+	size_t nBytes = std::max((size_t)1, (size_t)nIndividuals * conf->nWords) * sizeof(uint64_t);
+	void *chromosomes = NULL;
+	check(posix_memalign(&chromosomes, 64, nBytes) != 0, "%s\n", IND_ERROR_POPULATION_ALLOC);
+	memset(chromosomes, 0, nBytes);
+	this->chromosomes = (uint64_t *)chromosomes;
+	this->fitness = new float[conf->nObjectives * nIndividuals]();
+	this->crowding = new float[nIndividuals]();
+	this->rank = new int[nIndividuals];
+	this->nSelFeatures = new int[nIndividuals]();
+	std::fill(this->rank, this->rank + nIndividuals, -1);
+}
+
+/**
+ * @brief The destructor
+ */
+Population::~Population()
+{
+
+	free(this->chromosomes);
+	delete[] this->fitness;
+	delete[] this->crowding;
+	delete[] this->rank;
+	delete[] this->nSelFeatures;
+}
+
+/**
+ * @brief Gets a view of the population
+ * @param first The index of the first individual of the view
+ * @return The view
+ */
+Subpopulation Population::view(const int first) const
+{
+
+	Subpopulation view;
+	view.chromosomes = this->chromosomes;
+	view.fitness[0] = this->fitness;
+	view.fitness[1] = this->fitness + this->nIndividuals;
+	view.crowding = this->crowding;
+	view.rank = this->rank;
+	view.nSelFeatures = this->nSelFeatures;
+	view.nWords = this->nWords;
+	return view.from(first);
+}
+
+/**
+ * @brief Copies consecutive individuals between two views. The views must not overlap
+ * @param dest The destination view
+ * @param src The source view
+ * @param nIndividuals The number of individuals to be copied
+ */
+void copyIndividuals(const Subpopulation dest, const Subpopulation src, const int nIndividuals)
+{
+
+	memcpy(dest.chromosomes, src.chromosomes, (size_t)nIndividuals * src.nWords * sizeof(uint64_t));
+	memcpy(dest.fitness[0], src.fitness[0], nIndividuals * sizeof(float));
+	memcpy(dest.fitness[1], src.fitness[1], nIndividuals * sizeof(float));
+	memcpy(dest.crowding, src.crowding, nIndividuals * sizeof(float));
+	memcpy(dest.rank, src.rank, nIndividuals * sizeof(int));
+	memcpy(dest.nSelFeatures, src.nSelFeatures, nIndividuals * sizeof(int));
+}
+
+/**
+ * @brief Swaps two individuals of a view
+ * @param subpop The view
+ * @param i The index of the first individual
+ * @param j The index of the second individual
+ */
+void swapIndividuals(const Subpopulation subpop, const int i, const int j)
+{
+
+	std::swap_ranges(subpop.chromosome(i), subpop.chromosome(i) + subpop.nWords, subpop.chromosome(j));
+	std::swap(subpop.fitness[0][i], subpop.fitness[0][j]);
+	std::swap(subpop.fitness[1][i], subpop.fitness[1][j]);
+	std::swap(subpop.crowding[i], subpop.crowding[j]);
+	std::swap(subpop.rank[i], subpop.rank[j]);
+	std::swap(subpop.nSelFeatures[i], subpop.nSelFeatures[j]);
+}
+
+/**
+ * @brief Packs consecutive individuals of a view into records, so they can be sent to another process
+ * @param subpop The view
+ * @param nIndividuals The number of individuals to be packed
+ * @param records Where the records are stored
+ * @param conf The structure with all configuration parameters
+ */
+void packIndividuals(const Subpopulation subpop, const int nIndividuals, Individual *const records, const Config *const conf)
+{
+
+	for (int i = 0; i < nIndividuals; ++i)
+	{
+		Individual *record = getIndividual(records, i, conf);
+		record->fitness[0] = subpop.fitness[0][i];
+		record->fitness[1] = subpop.fitness[1][i];
+		record->crowding = subpop.crowding[i];
+		record->rank = subpop.rank[i];
+		record->nSelFeatures = subpop.nSelFeatures[i];
+		memcpy(record->chromosome, subpop.chromosome(i), subpop.nWords * sizeof(uint64_t));
+	}
+}
+
+/**
+ * @brief Unpacks records into consecutive individuals of a view
+ * @param records The records
+ * @param nIndividuals The number of individuals to be unpacked
+ * @param subpop The view
+ * @param conf The structure with all configuration parameters
+ */
+void unpackIndividuals(const Individual *const records, const int nIndividuals, const Subpopulation subpop, const Config *const conf)
+{
 
-	// Search for individuals who belong to the first front
-	int nFronts = 0;
 	for (int i = 0; i < nIndividuals; ++i)
 	{
-		for (int j = i + 1; j < nIndividuals; ++j)
+		const Individual *record = getIndividual(records, i, conf);
+		subpop.fitness[0][i] = record->fitness[0];
+		subpop.fitness[1][i] = record->fitness[1];
+		subpop.crowding[i] = record->crowding;
+		subpop.rank[i] = record->rank;
+		subpop.nSelFeatures[i] = record->nSelFeatures;
+		memcpy(subpop.chromosome(i), record->chromosome, subpop.nWords * sizeof(uint64_t));
+	}
+}
+
+/**
+ * @brief Checks if an individual dominates another one (all objectives are minimized)
+ * @param data The sorting data with the fitness of the individuals
+ * @param ind1 The index of the first individual
+ * @param ind2 The index of the second individual
+ * @param nObjectives The number of objectives
+ * @return true if the first individual is not worse in any objective and better in at least one
+ */
+static bool dominates(const SortingData &data, const int ind1, const int ind2, const unsigned char nObjectives)
+{
+
+	const int nIndividuals = data.nIndividuals;
+	bool better = false;
+	for (unsigned char obj = 0; obj < nObjectives; ++obj)
+	{
+		float fit1 = data.fitness[obj * nIndividuals + ind1];
+		float fit2 = data.fitness[obj * nIndividuals + ind2];
+		if (fit1 > fit2)
 		{
-			u_char domLess = 0;
-			u_char domEqual = 0;
-			u_char domMore = 0;
-			for (u_char obj = 0; obj < conf->nObjectives; ++obj)
-			{
-				if (subpop[i].fitness[obj] < subpop[j].fitness[obj])
-				{
-					++domLess;
-				}
-				else if (subpop[i].fitness[obj] == subpop[j].fitness[obj])
-				{
-					++domEqual;
-				}
-				else
-				{
-					++domMore;
-				}
-			}
+			return false;
+		}
+		better |= (fit1 < fit2);
+	}
 
-			if (domLess == 0 && domEqual != conf->nObjectives)
+	return better;
+}
+
+/**
+ * @brief Assigns the Pareto fronts for two objectives in O(N log N) (sort and sweep with binary search over the fronts)
+ * @param data The sorting data with the fitness of the individuals. Ranks are stored in it
+ * @param order The indexes of the individuals in lexicographical order
+ * @param last The last individual added to each front
+ * @param previous The individual added to the same front before each individual (-1 if it is the first one)
+ * @return The number of fronts
+ */
+static int assignFronts2D(SortingData &data, const int *const order, int *const last, int *const previous)
+{
+
+	// In lexicographical order, an individual can only be dominated by the previous ones. Inside a front, the second
+	// objective decreases along the sweep, so the last individual added to a front is the only candidate to dominate
+	const int nIndividuals = data.nIndividuals;
+	const float *const fit0 = data.fitness;
+	const float *const fit1 = data.fitness + nIndividuals;
+	int nFronts = 0;
+	for (int n = 0; n < nIndividuals; ++n)
+	{
+		int p = order[n];
+
+		// Binary search of the first front whose last individual does not dominate 'p'
+		int lo = 0;
+		int hi = nFronts;
+		while (lo < hi)
+		{
+			int mid = (lo + hi) >> 1;
+			int q = last[mid];
+			if (fit1[q] < fit1[p] || (fit1[q] == fit1[p] && fit0[q] < fit0[p]))
 			{
-				++indivDomination[i].second;
-				indivDomination[j].first.push_back(i);
+				lo = mid + 1;
 			}
-			else if (domMore == 0 && domEqual != conf->nObjectives)
+			else
 			{
-				indivDomination[i].first.push_back(j);
-				++indivDomination[j].second;
+				hi = mid;
 			}
 		}
 
-		if (indivDomination[i].second == 0)
-		{
-			subpop[i].rank = 0;
-			front[0].push_back(i);
-		}
+		previous[p] = (lo == nFronts) ? -1 : last[lo];
+		nFronts += (lo == nFronts);
+		last[lo] = p;
+		data.rank[p] = lo;
 	}
 
-	// Find the subsequent fronts
-	while (!front[nFronts].empty())
+	return nFronts;
+}
+
+/**
+ * @brief Assigns the Pareto fronts for any number of objectives (efficient non-dominated sort with sequential search)
+ * @param data The sorting data with the fitness of the individuals. Ranks are stored in it
+ * @param order The indexes of the individuals in lexicographical order
+ * @param nObjectives The number of objectives
+ * @param last The last individual added to each front
+ * @param previous The individual added to the same front before each individual (-1 if it is the first one)
+ * @return The number of fronts
+ */
+static int assignFrontsENS(SortingData &data, const int *const order, const unsigned char nObjectives, int *const last, int *const previous)
+{
+
+	// In lexicographical order, an individual can only be dominated by the previous ones
+	const int nIndividuals = data.nIndividuals;
+	int nFronts = 0;
+	for (int n = 0; n < nIndividuals; ++n)
 	{
-		front.push_back(std::vector<int>());
-		int sizeActualFront = front[nFronts].size();
-		for (int i = 0; i < sizeActualFront; ++i)
+		int p = order[n];
+		int f = 0;
+		for (bool dominated = true; dominated && f < nFronts;)
 		{
-			int nDomByInd = (int)indivDomination[front[nFronts][i]].first.size();
-			for (int j = 0; j < nDomByInd; ++j)
+
+			// The last individuals added to the front are the most likely to dominate 'p'
+			dominated = false;
+			for (int q = last[f]; q >= 0 && !dominated; q = previous[q])
 			{
-				int dominateToInd = indivDomination[front[nFronts][i]].first[j];
-				int nDomToInd = (--indivDomination[dominateToInd].second);
-				if (nDomToInd == 0)
-				{
-					subpop[dominateToInd].rank = nFronts + 1;
-					front[nFronts + 1].push_back(dominateToInd);
-				}
+				dominated = dominates(data, q, p, nObjectives);
 			}
+			f += dominated;
 		}
-		++nFronts;
+
+		previous[p] = (f == nFronts) ? -1 : last[f];
+		nFronts += (f == nFronts);
+		last[f] = p;
+		data.rank[p] = f;
 	}
 
-	front.pop_back();
+	return nFronts;
+}
 
-	// Sort the individuals according to the rank
-	std::sort(subpop, subpop + nIndividuals, rankCompare());
+/**
+ * @brief Moves the chromosomes and the number of selected features to the positions given by a permutation
+ *
+ * Each array is gathered in a temporary buffer and copied back, so every chromosome is copied twice but sequentially
+ * @param subpop Current subpopulation
+ * @param source The individual which goes to each position
+ * @param nIndividuals The number of individuals
+ * @param arena The scratch arena where the temporary buffers are stored
+ */
+static void applyPermutation(const Subpopulation subpop, const int *const source, const int nIndividuals, ScratchArena *const arena)
+{
+
+	const size_t mark = arena->mark();
+	const int nWords = subpop.nWords;
+	uint64_t *const chromosomes = arena->allocate<uint64_t>((size_t)nIndividuals * nWords);
+	for (int i = 0; i < nIndividuals; ++i)
+	{
+		memcpy(chromosomes + (size_t)i * nWords, subpop.chromosome(source[i]), nWords * sizeof(uint64_t));
+	}
+	memcpy(subpop.chromosomes, chromosomes, (size_t)nIndividuals * nWords * sizeof(uint64_t));
+
+	int *const nSelFeatures = arena->allocate<int>(nIndividuals);
+	for (int i = 0; i < nIndividuals; ++i)
+	{
+		nSelFeatures[i] = subpop.nSelFeatures[source[i]];
+	}
+	std::copy(nSelFeatures, nSelFeatures + nIndividuals, subpop.nSelFeatures);
+	arena->release(mark);
+}
+
+/**
+ * @brief Perform non-dominated sorting on the subpopulation
+ * @param subpop Current subpopulation
+ * @param nIndividuals The number of individuals which will be sorted
+ * @param arena The scratch arena where the temporaries are stored
+ * @param conf The structure with all configuration parameters
+ * @return The number of individuals in the front 0
+ */
+int nonDominationSort(const Subpopulation subpop, const int nIndividuals, ScratchArena *const arena, const Config *const conf)
+{
+
+	// Gather the small fields of the individuals into the sorting data
+	const size_t mark = arena->mark();
+	SortingData data;
+	data.fitness = arena->allocate<float>(conf->nObjectives * nIndividuals);
+	data.crowding = arena->allocate<float>(nIndividuals);
+	data.rank = arena->allocate<int>(nIndividuals);
+	data.index = arena->allocate<int>(nIndividuals);
+	data.nIndividuals = nIndividuals;
+	for (int i = 0; i < nIndividuals; ++i)
+	{
+		for (u_char obj = 0; obj < conf->nObjectives; ++obj)
+		{
+			data.fitness[obj * nIndividuals + i] = subpop.fitness[obj][i];
+		}
+		data.crowding[i] = subpop.crowding[i];
+		data.index[i] = i;
+	}
+
+	// Classify the individuals into Pareto fronts. Two objectives have a specialised sweep
+	// Each front is a list linked from its last individual to the first one
+	int *const last = arena->allocate<int>(nIndividuals);
+	int *const previous = arena->allocate<int>(nIndividuals);
+	int nFronts;
+	std::sort(data.index, data.index + nIndividuals, lexicographicCompare(&data, conf->nObjectives));
+	if (conf->nObjectives == 2)
+	{
+		nFronts = assignFronts2D(data, data.index, last, previous);
+	}
+	else
+	{
+		nFronts = assignFrontsENS(data, data.index, conf->nObjectives, last, previous);
+	}
+
+	// The members of each front are grouped in lexicographical order (counting sort by rank)
+	int *const frontStart = arena->allocate<int>(nIndividuals + 1);
+	int *const members = arena->allocate<int>(nIndividuals);
+	std::fill(frontStart, frontStart + nFronts + 1, 0);
+	for (int i = 0; i < nIndividuals; ++i)
+	{
+		++frontStart[data.rank[i] + 1];
+	}
+	for (int f = 0; f < nFronts; ++f)
+	{
+		frontStart[f + 1] += frontStart[f];
+		last[f] = frontStart[f];
+	}
+	for (int n = 0; n < nIndividuals; ++n)
+	{
+		int p = data.index[n];
+		members[last[data.rank[p]]++] = p;
+	}
 
 	// Find the crowding distance for each individual in each front
-	for (int f = 0, i = 0; f < nFronts; ++f)
+	for (int f = 0; f < nFronts; ++f)
 	{
-		int sizeFrontI = (int)front[f].size();
-		Individual *begin = subpop + i;
-		Individual *end = begin + sizeFrontI;
+		int *const front = members + frontStart[f];
+		int sizeFrontI = frontStart[f + 1] - frontStart[f];
 		for (u_char obj = 0; obj < conf->nObjectives; ++obj)
 		{
-			std::sort(begin, end, objectiveCompare(obj));
-			float fMin = begin->fitness[obj];
-			float fMax = (end - 1)->fitness[obj];
-			begin->crowding = INFINITY;
-			(end - 1)->crowding = INFINITY;
+			const float *const fitness = data.fitness + obj * nIndividuals;
+			std::sort(front, front + sizeFrontI, objectiveCompare(fitness));
+			float fMin = fitness[front[0]];
+			float fMax = fitness[front[sizeFrontI - 1]];
+			data.crowding[front[0]] = INFINITY;
+			data.crowding[front[sizeFrontI - 1]] = INFINITY;
 			bool fMaxFminZero = (fMax == fMin);
 
 			for (int j = 1; j < sizeFrontI - 1; ++j)
 			{
-				Individual *current = begin + j;
+				float &current = data.crowding[front[j]];
 				if (fMaxFminZero)
 				{
-					current->crowding = INFINITY;
+					current = INFINITY;
 				}
-				else if (current->crowding != INFINITY)
+				else if (current != INFINITY)
 				{
-					float nextObj = (current + 1)->fitness[obj];
-					float previousObj = (current - 1)->fitness[obj];
-					current->crowding += (nextObj - previousObj) / (fMax - fMin);
+					float nextObj = fitness[front[j + 1]];
+					float previousObj = fitness[front[j - 1]];
+					current += (nextObj - previousObj) / (fMax - fMin);
 				}
 			}
 		}
-
-		i += sizeFrontI;
 	}
 
-	// Sort the individuals according to the rank and Crowding distance
-	std::sort(subpop, subpop + nIndividuals, rankAndCrowdingCompare());
+	// Sort the individual indexes according to the rank and Crowding distance
+	std::sort(data.index, data.index + nIndividuals, rankAndCrowdingCompare(&data));
+
+	// The small fields are written straight in their final position. The rest of the data is moved afterwards
+	for (int i = 0; i < nIndividuals; ++i)
+	{
+		int source = data.index[i];
+		for (u_char obj = 0; obj < conf->nObjectives; ++obj)
+		{
+			subpop.fitness[obj][i] = data.fitness[obj * nIndividuals + source];
+		}
+		subpop.rank[i] = data.rank[source];
+		subpop.crowding[i] = data.crowding[source];
+	}
+	applyPermutation(subpop, data.index, nIndividuals, arena);
 
-	return front[0].size();
+	int nIndFront0 = (nFronts > 0) ? frontStart[1] : 0;
+	arena->release(mark);
+	return nIndFront0;
 }
@@ -55,9 +55,20 @@ int main(const int argc, const char **argv)
 	std::cout << "Process " << conf.mpiRank << " [main]: MPI Rank: " << conf.mpiRank << ", MPI Size: " << conf.mpiSize << std::endl;
 #endif
 
-	Individual *subpops;
+	// Convert the training database to binary format and exit
+	if (!conf.trConvFileName.empty())
+	{
+		if (conf.mpiRank == 0)
+		{
+			convertDataBase(&conf);
+			std::cout << "Process " << conf.mpiRank << " [main]: Training database written to " << conf.trConvFileName << std::endl;
+		}
+		MPI::Finalize();
+		return 0;
+	}
+
+	Population *population = NULL;
 	int *selInstances;
-	srand((uint)time(NULL) + conf.mpiRank);
 
 	// Master prints configuration parameters
 	if (conf.mpiRank == 0)
@@ -75,19 +86,30 @@ int main(const int argc, const char **argv)
 		std::cout << "Process " << conf.mpiRank << " [main]:   trNInstances:         " << conf.trNInstances << std::endl;
 		std::cout << "Process " << conf.mpiRank << " [main]:   trDataBaseFileName:   " << conf.trDataBaseFileName << std::endl;
 		std::cout << "Process " << conf.mpiRank << " [main]:   trNormalize:          " << conf.trNormalize << std::endl;
+		std::cout << "Process " << conf.mpiRank << " [main]:   trDistribution:       " << conf.trDistribution << std::endl;
 		std::cout << "Process " << conf.mpiRank << " [main]:   tourSize:             " << conf.tourSize << std::endl;
 		std::cout << "Process " << conf.mpiRank << " [main]:   nDevices:             " << conf.nDevices << std::endl;
 		std::cout << "Process " << conf.mpiRank << " [main]:   ompThreads:           " << conf.ompThreads << std::endl;
+		std::cout << "Process " << conf.mpiRank << " [main]:   seed:                 " << conf.seed << std::endl;
+		std::cout << "Process " << conf.mpiRank << " [main]:   cpuIsa:               " << conf.cpuIsa << std::endl;
+		std::cout << "Process " << conf.mpiRank << " [main]:   K:                    " << conf.K << std::endl;
+		std::cout << "Process " << conf.mpiRank << " [main]:   maxIterKmeans:        " << conf.maxIterKmeans << std::endl;
+		std::cout << "Process " << conf.mpiRank << " [main]:   kmeansMode:           " << conf.kmeansMode << std::endl;
 #endif
 	}
 
+#if LOG_ENABLED
+	std::cout << "Process " << conf.mpiRank << " [main]: Getting training database..." << std::endl;
+#endif
+	const float *const trDataBase = distributeDataBase(&conf);
+
 	// Master with workers
 	if (conf.mpiRank == 0 && conf.mpiSize > 1)
 	{
 #if LOG_ENABLED
 		std::cout << "Process " << conf.mpiRank << " [main]: Initializing subpopulations..." << std::endl;
 #endif
-		subpops = createSubpopulations(&conf);
+		population = createSubpopulations(&conf);
 #if LOG_ENABLED
 		std::cout << "Process " << conf.mpiRank << " [main]: Subpopulations initialized." << std::endl;
 #endif
@@ -99,10 +121,14 @@ int main(const int argc, const char **argv)
 #endif
 		MPI::COMM_WORLD.Bcast(selInstances, conf.K, MPI::INT, 0);
 
+		// The master has nothing to tune
+		if (!conf.tune)
+		{
 #if LOG_ENABLED
-		std::cout << "Process " << conf.mpiRank << " [main]: Starting genetic algorithm..." << std::endl;
+			std::cout << "Process " << conf.mpiRank << " [main]: Starting genetic algorithm..." << std::endl;
 #endif
-		agIslands(subpops, NULL, NULL, NULL, &conf);
+			agIslands(population, NULL, NULL, NULL, NULL, &conf);
+		}
 	}
 	else
 	{
@@ -110,7 +136,6 @@ int main(const int argc, const char **argv)
 		std::cout << "Process " << conf.mpiRank << " [main]: Running..." << std::endl;
 #endif
 
-		const float *const trDataBase = getDataBase(&conf);
 		const float *const transposedTrDataBase = transposeDataBase(trDataBase, &conf);
 
 		// Master works alone
@@ -119,7 +144,7 @@ int main(const int argc, const char **argv)
 #if LOG_ENABLED
 			std::cout << "Process " << conf.mpiRank << " [main]: Single process mode detected. Creating subpopulations and centroids..." << std::endl;
 #endif
-			subpops = createSubpopulations(&conf);
+			population = createSubpopulations(&conf);
 			selInstances = getCentroids(&conf);
 		}
 		// Workers receive subpopulations and centroids from master
@@ -137,20 +162,37 @@ int main(const int argc, const char **argv)
 #endif
 		CLDevice *devices = createDevices(trDataBase, selInstances, transposedTrDataBase, &conf);
 
+		// Tune the devices and exit
+		if (conf.tune)
+		{
 #if LOG_ENABLED
-		std::cout << "Process " << conf.mpiRank << " [main]: Starting genetic algorithm..." << std::endl;
+			std::cout << "Process " << conf.mpiRank << " [main]: Tuning devices..." << std::endl;
 #endif
-		agIslands(subpops, devices, trDataBase, selInstances, &conf);
+			tuneDevices(devices, &conf);
+		}
+		else
+		{
+
+			// The fitness cache is only needed by the processes which evaluate
+			FitnessCache *fitnessCache = (conf.fitnessCacheSize > 0) ? new FitnessCache(&conf) : NULL;
 
 #if LOG_ENABLED
-		std::cout << "Process " << conf.mpiRank << " [main]: Deleting devices..." << std::endl;
+			std::cout << "Process " << conf.mpiRank << " [main]: Starting genetic algorithm..." << std::endl;
 #endif
-		delete[] devices;
+			agIslands(population, devices, trDataBase, selInstances, fitnessCache, &conf);
+
+			if (fitnessCache != NULL)
+			{
+				fitnessCache->printStats(&conf);
+				delete fitnessCache;
+			}
+			printKmeansStats(&conf);
+		}
 
 #if LOG_ENABLED
-		std::cout << "Process " << conf.mpiRank << " [main]: Deleting training database..." << std::endl;
+		std::cout << "Process " << conf.mpiRank << " [main]: Deleting devices..." << std::endl;
 #endif
-		delete[] trDataBase;
+		delete[] devices;
 
 #if LOG_ENABLED
 		std::cout << "Process " << conf.mpiRank << " [main]: Deleting transposed training database..." << std::endl;
@@ -163,7 +205,7 @@ int main(const int argc, const char **argv)
 #if LOG_ENABLED
 		std::cout << "Process " << conf.mpiRank << " [main]: Deleting subpopulations..." << std::endl;
 #endif
-		delete[] subpops;
+		delete population;
 
 #if LOG_ENABLED
 		std::cout << "Process " << conf.mpiRank << " [main]: Deleting selected instances..." << std::endl;
@@ -171,6 +213,11 @@ int main(const int argc, const char **argv)
 		delete[] selInstances;
 	}
 
+#if LOG_ENABLED
+	std::cout << "Process " << conf.mpiRank << " [main]: Deleting training database..." << std::endl;
+#endif
+	freeDataBase(trDataBase);
+
 #if LOG_ENABLED
 	std::cout << "Process " << conf.mpiRank << " [main]: Finalizing MPI environment..." << std::endl;
 #endif
@@ -16,7 +16,7 @@ fi
 
 # Print info message
 echo "------------------------------------------------------------"
-echo "Entering directory: $WORKDIR and running make clean and make -j N_FEATURES=3600"
+echo "Entering directory: $WORKDIR and running make clean and make -j"
 echo "------------------------------------------------------------"
 
 # Change to the specified directory
@@ -24,4 +24,4 @@ cd "$WORKDIR" || exit 3
 
 # Run make commands
 make clean
-make -j N_FEATURES=3600
\ No newline at end of file
+make -j
\ No newline at end of file